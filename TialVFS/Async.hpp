@@ -0,0 +1,283 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+namespace Tial {
+namespace VFS {
+
+class ThreadPool;
+
+// Runs tasks of asynchronous operations somewhere else than the calling thread
+class TIALVFS_EXPORT Executor {
+public:
+	virtual ~Executor() = 0;
+	virtual void execute(std::function<void()> task) = 0;
+};
+
+class TIALVFS_EXPORT ThreadPoolExecutor: public Executor {
+	std::shared_ptr<ThreadPool> pool;
+
+public:
+	explicit ThreadPoolExecutor(const std::shared_ptr<ThreadPool> &pool);
+	virtual void execute(std::function<void()> task) override;
+};
+
+template<typename T>
+class Task;
+
+template<typename T>
+class Promise;
+
+namespace Detail {
+
+template<typename T>
+class TaskValue {
+	boost::optional<T> value;
+
+public:
+	void set(T value) {
+		this->value = std::move(value);
+	}
+
+	T get() const {
+		return *value;
+	}
+
+	void fulfil(std::promise<T> &promise) const {
+		promise.set_value(*value);
+	}
+
+	template<typename Function>
+	void invoke(Function &function) {
+		set(function());
+	}
+};
+
+template<>
+class TaskValue<void> {
+public:
+	void set() {}
+	void get() const {}
+
+	void fulfil(std::promise<void> &promise) const {
+		promise.set_value();
+	}
+
+	template<typename Function>
+	void invoke(Function &function) {
+		function();
+	}
+};
+
+template<typename T>
+class TaskState: public TaskValue<T> {
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool done = false;
+	std::exception_ptr error;
+	std::vector<std::function<void()>> continuations;
+
+public:
+	bool ready() {
+		std::unique_lock<std::mutex> lock(mutex);
+		return done;
+	}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() {
+			return done;
+		});
+	}
+
+	std::exception_ptr exception() {
+		std::unique_lock<std::mutex> lock(mutex);
+		return error;
+	}
+
+	void then(std::function<void()> continuation) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if(!done) {
+			continuations.push_back(std::move(continuation));
+			return;
+		}
+		lock.unlock();
+		continuation();
+	}
+
+	// like then(), but nothing is called and false is returned if already done
+	bool thenIfPending(std::function<void()> continuation) {
+		std::unique_lock<std::mutex> lock(mutex);
+		if(done)
+			return false;
+		continuations.push_back(std::move(continuation));
+		return true;
+	}
+
+	// value or error has to be set before
+	void complete(std::exception_ptr exception = nullptr) {
+		std::vector<std::function<void()>> continuations;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			error = exception;
+			done = true;
+			continuations.swap(this->continuations);
+		}
+		condition.notify_all();
+		for(auto &continuation: continuations)
+			continuation();
+	}
+};
+
+}
+
+// Result of an asynchronous operation. May be waited for, turned into a std::future,
+// given a continuation, or awaited by C++20 coroutines (resumed on the thread that
+// completed the operation). Copies share the same result.
+template<typename T>
+class Task {
+	std::shared_ptr<Detail::TaskState<T>> state;
+
+	explicit Task(const std::shared_ptr<Detail::TaskState<T>> &state): state(state) {}
+
+public:
+	Task() = default;
+
+	bool valid() const {
+		return static_cast<bool>(state);
+	}
+
+	bool ready() const {
+		return state->ready();
+	}
+
+	void wait() const {
+		state->wait();
+	}
+
+	// waits for the result, rethrows exception of failed operation
+	T get() const {
+		state->wait();
+		if(auto error = state->exception())
+			std::rethrow_exception(error);
+		return state->get();
+	}
+
+	// called once the operation finishes, right away if it already has
+	void then(std::function<void()> continuation) const {
+		state->then(std::move(continuation));
+	}
+
+	std::future<T> future() const {
+		auto promise = std::make_shared<std::promise<T>>();
+		auto state = this->state;
+		state->then([state, promise]() {
+			if(auto error = state->exception())
+				promise->set_exception(error);
+			else
+				state->fulfil(*promise);
+		});
+		return promise->get_future();
+	}
+
+#if defined(__cpp_impl_coroutine)
+	bool await_ready() const {
+		return ready();
+	}
+
+	// coroutine is not suspended if the task completed in the meantime
+	bool await_suspend(std::coroutine_handle<> handle) const {
+		return state->thenIfPending([handle]() {
+			handle.resume();
+		});
+	}
+
+	T await_resume() const {
+		return get();
+	}
+#endif
+
+	friend class Promise<T>;
+};
+
+// Producing side of a Task
+template<typename T>
+class Promise {
+	std::shared_ptr<Detail::TaskState<T>> state = std::make_shared<Detail::TaskState<T>>();
+
+public:
+	Task<T> task() const {
+		return Task<T>(state);
+	}
+
+	template<typename... Args>
+	void setValue(Args&&... args) const {
+		state->set(std::forward<Args>(args)...);
+		state->complete();
+	}
+
+	void setException(std::exception_ptr error) const {
+		state->complete(error);
+	}
+
+	// stores result of function, or exception thrown by it
+	template<typename Function>
+	void run(Function &function) const {
+		try {
+			state->invoke(function);
+		} catch(...) {
+			state->complete(std::current_exception());
+			return;
+		}
+		state->complete();
+	}
+};
+
+// Runs function on executor, task completes with its result
+template<typename Function>
+auto async(Executor &executor, Function function) -> Task<decltype(function())> {
+	Promise<decltype(function())> promise;
+	executor.execute([promise, function]() mutable {
+		promise.run(function);
+	});
+	return promise.task();
+}
+
+// Task completing with result of source, once function was called after source finished
+template<typename T, typename Function>
+Task<T> after(const Task<T> &source, Function function) {
+	Promise<T> promise;
+	source.then([source, promise, function]() mutable {
+		auto result = [&source, &function]() {
+			function();
+			return source.get();
+		};
+		promise.run(result);
+	});
+	return promise.task();
+}
+
+// Runs function right away, on calling thread; for operations that cannot block
+template<typename Function>
+auto completed(Function function) -> Task<decltype(function())> {
+	Promise<decltype(function())> promise;
+	promise.run(function);
+	return promise.task();
+}
+
+}
+}
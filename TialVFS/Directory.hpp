@@ -1,14 +1,16 @@
 #pragma once
 #include "TialVFSExport.hpp"
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
-#include <unordered_map>
 #include <vector>
 
 #include <TialUtility/TialUtility.hpp>
 
 #include "Common.hpp"
+#include "DirectoryContent.hpp"
 #include "Driver.hpp"
 #include "File.hpp"
 #include "Object.hpp"
@@ -18,36 +20,100 @@
 namespace Tial {
 namespace VFS {
 
-struct BasenameHash: public std::hash<std::string> {
-	size_t operator()(const std::string &x) const;
-};
-
-struct BasenameCompare {
-	bool operator()(const std::string &x, const std::string &y) const;
-};
-
 class TIALVFS_EXPORT Directory: public Object {
+public:
+	// outcome of the last reconciliation of cached content with driver listing
+	struct Reconciliation {
+		size_t added = 0;
+		size_t removed = 0;
+		size_t kept = 0;
+	};
+
+	enum class Traversal {
+		DepthFirst,
+		BreadthFirst,
+		// sibling directories are listed concurrently on thread pool of the root, visiting
+		// order is unspecified and function may be called from several threads at once
+		Parallel
+	};
+
+	// what walk() should do after visiting an element
+	enum class Visit {
+		Continue,
+		Skip, // do not descend into visited directory
+		Stop
+	};
+
+private:
 	std::shared_ptr<Driver> _driver;
+	bool _caseSensitive = false;
 	std::recursive_mutex mutex;
-	std::unordered_map<std::string, std::shared_ptr<Object>, BasenameHash, BasenameCompare> _content;
+	DirectoryContent _content;
+	// _content is not changed while iterated; changes made meanwhile go to pending copy of
+	// it, which replaces _content when the last iteration ends
+	size_t iterations = 0;
+	std::unique_ptr<DirectoryContent> pendingContent;
+	// advanced whenever content is invalidated or relisted, children validated against older one are Invalid
+	std::atomic<uintmax_t> _generation{0};
+	Reconciliation _reconciliation;
+
+	// iterates _content in place, without holding the mutex
+	class Iteration {
+		Directory &directory;
+	public:
+		explicit Iteration(Directory &directory);
+		~Iteration();
+		Iteration(const Iteration&) = delete;
+		Iteration &operator=(const Iteration&) = delete;
+
+		const DirectoryContent &content() const;
+	};
+
+	// both need mutex to be held
+	const DirectoryContent &currentContent() const;
+	DirectoryContent &modifiableContent();
 
 	virtual void validate() override;
 	virtual void markInvalid() override;
 	virtual void markBroken() override;
-	std::shared_ptr<Tial::VFS::Object> entryToObject(const Driver::FileEntry &entry);
-	static bool entryMatchesObject(const Driver::FileEntry &entry, const std::shared_ptr<Object> &object);
+	std::shared_ptr<Tial::VFS::Object> entryToObject(const std::string &name, bool directory);
+	void invalidateNegativeLookups();
+	void insertCreated(const std::shared_ptr<Object> &object);
+	void eraseRemoved(const Object &object);
+	static bool objectMatches(const std::shared_ptr<Object> &object, const char *name, size_t size, bool directory);
 	std::pair<Path, std::shared_ptr<Driver>> driver() const;
+	bool caseSensitive() const;
+	// returns null when path does not exist or leads through a file, unless it is required
+	std::shared_ptr<Object> resolve(const Path &path, bool required = false);
+	std::shared_ptr<Object> lookup(const Path &path);
 	std::shared_ptr<Object> get(const Path &path);
+	bool walkDepthFirst(const std::function<Visit(const std::shared_ptr<Object> &)> &function);
+	bool walkBreadthFirst(const std::function<Visit(const std::shared_ptr<Object> &)> &function);
+	bool walkParallel(const std::function<Visit(const std::shared_ptr<Object> &)> &function);
 
 protected:
 	Directory(const std::shared_ptr<Root> &root, const std::shared_ptr<Directory> &directory, const std::string &name);
 
 public:
-	void mount(const std::shared_ptr<Driver> &driver);
+	void mount(const std::shared_ptr<Driver> &driver, bool caseSensitive = false);
 	void unmount();
 
 	std::vector<std::shared_ptr<Object>> content();
-	std::vector<std::shared_ptr<Object>> collect();
+	// Elements with names matching filter, compared with case sensitivity of the mount. Unless
+	// content is already cached, only matching entries are listed by the driver and added to
+	// the cache, without making the whole directory Valid.
+	std::vector<std::shared_ptr<Object>> content(const NamePattern &filter);
+	std::vector<std::shared_ptr<Object>> collect(Traversal traversal = Traversal::DepthFirst);
+
+	// Visit elements of the directory as cached when its iteration starts. Nothing is copied;
+	// function may add or remove elements, but changes made while the directory is iterated
+	// are applied to the iterated content only after the last iteration over it ends, lookups
+	// see them at once. Function returns false (or Visit::Stop) to end iteration early. Both
+	// return false if iteration was stopped.
+	bool forEachChild(const std::function<bool(const std::shared_ptr<Object> &)> &function);
+	bool walk(const std::function<Visit(const std::shared_ptr<Object> &)> &function,
+		Traversal traversal = Traversal::DepthFirst);
+	Reconciliation reconciliation();
 
 	template<typename T>
 	std::shared_ptr<T> get(const Path &path) {
@@ -56,15 +122,31 @@ public:
 		return object;
 	}
 
-	std::vector<std::shared_ptr<Object>> getAll(const Path &path);
+	// returns null instead of throwing when path does not exist or is of different type
+	template<typename T>
+	std::shared_ptr<T> tryGet(const Path &path) {
+		return std::dynamic_pointer_cast<T>(lookup(path));
+	}
+
+	bool exists(const Path &path);
+
+	std::vector<std::shared_ptr<Object>> getAll(const Path &path, Traversal traversal = Traversal::DepthFirst);
 
 	std::shared_ptr<File> createFile(const std::string &name);
 	std::shared_ptr<Directory> createDirectory(const std::string &name);
 
+	// asynchronous variants, run on executor of the root
+	Task<std::vector<std::shared_ptr<Object>>> contentAsync();
+	Task<std::shared_ptr<File>> createFileAsync(const std::string &name);
+	Task<std::shared_ptr<Directory>> createDirectoryAsync(const std::string &name);
+
 	virtual void remove() override;
 
 	friend class Driver;
 	friend class File;
+	friend class Glob;
+	friend class Object;
+	friend class Root;
 };
 
 }
@@ -0,0 +1,78 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Common.hpp"
+
+namespace Tial {
+namespace VFS {
+
+class Object;
+
+// Flat open-addressing table of directory entries, keyed by the name of each object.
+// Small directories are kept as a dense array and scanned linearly; bigger ones switch to
+// linear probing over a power-of-two array. Hashes are computed once, on ASCII-folded names
+// unless the table is case sensitive, and stored inline next to the object.
+class TIALVFS_EXPORT DirectoryContent {
+	struct Slot {
+		uint64_t hash = 0;
+		std::shared_ptr<Object> object;
+	};
+
+	static const size_t smallCapacity = 8;
+
+	std::vector<Slot> slots;
+	size_t _size = 0;
+	bool hashed = false;
+	bool _caseSensitive = false;
+
+	bool slotMatches(const Slot &slot, const char *name, size_t size, uint64_t hash) const;
+	size_t findSlot(const char *name, size_t size, uint64_t hash) const;
+	void insertHashed(Slot &&slot);
+	void rehash(size_t capacity);
+
+public:
+	class const_iterator {
+		const Slot *slot;
+		const Slot *end;
+
+		void skipEmpty();
+	public:
+		const_iterator(const Slot *slot, const Slot *end);
+
+		const std::shared_ptr<Object> &operator*() const;
+		const std::shared_ptr<Object> *operator->() const;
+		const_iterator &operator++();
+		bool operator==(const const_iterator &other) const;
+		bool operator!=(const const_iterator &other) const;
+	};
+
+	static uint64_t hash(const std::string &name, bool caseSensitive);
+	static uint64_t hash(const char *name, size_t size, bool caseSensitive);
+	static bool equal(const std::string &first, const std::string &second, bool caseSensitive);
+	// compares two names of the same size
+	static bool equal(const char *first, const char *second, size_t size, bool caseSensitive);
+
+	bool caseSensitive() const;
+	void setCaseSensitive(bool caseSensitive);
+
+	size_t size() const;
+	bool empty() const;
+
+	const std::shared_ptr<Object> *find(const std::string &name) const;
+	const std::shared_ptr<Object> *find(const char *name, size_t size) const;
+	bool insert(const std::shared_ptr<Object> &object);
+	std::shared_ptr<Object> erase(const std::string &name);
+	void reserve(size_t size);
+	void clear();
+
+	const_iterator begin() const;
+	const_iterator end() const;
+};
+
+}
+}
@@ -1,19 +1,31 @@
 #pragma once
 #include "TialVFSExport.hpp"
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <boost/optional.hpp>
+
 #include <TialUtility/Logger.hpp>
 
+#include "Async.hpp"
 #include "Common.hpp"
+#include "NamePattern.hpp"
 
 namespace Tial {
 namespace VFS {
 
 class Object;
 class Directory;
+class ThreadPool;
 
 class Mapping;
 
@@ -30,37 +42,233 @@ protected:
 	std::vector<std::weak_ptr<Directory>> mountPoints;
 
 public:
+	// pieces of memory for scatter/gather transfers
+	struct Buffer {
+		void *data;
+		size_t size;
+	};
+
+	struct ConstBuffer {
+		const void *data;
+		size_t size;
+	};
+
+	// Hints on how data is going to be accessed; drivers ignore the ones they cannot use
+	enum class Advice {
+		Normal,
+		Sequential,
+		Random,
+		WillNeed,
+		DontNeed,
+		HugePage
+	};
+
+	// Positional access to file content; implementations do not keep a file offset, so one
+	// OpenFile may be used by several threads at once if the driver allows concurrent access
+	// to a file. NativeFSDriver does; MemoryDriver does not, its writes resize a shared buffer.
 	class OpenFile {
 	public:
 		virtual ~OpenFile() = 0;
+		// transfer the whole buffer, reads stop early only at end of file
 		virtual size_t read(size_t pos, void *buffer, size_t bufferSize) = 0;
 		virtual size_t write(size_t pos, const void *buffer, size_t bufferSize) = 0;
+		// Transfer buffers in order as one contiguous range starting at pos, returning
+		// number of bytes transferred; stops early at end of file. Default implementations
+		// call read() or write() for every buffer.
+		virtual size_t readv(size_t pos, const std::vector<Buffer> &buffers);
+		virtual size_t writev(size_t pos, const std::vector<ConstBuffer> &buffers);
 		virtual size_t size() = 0;
+		// length of zero means up to end of file; default implementation ignores advice
+		virtual void advise(Advice advice, uintmax_t offset, uintmax_t length);
+		// returns once data written so far is durable; default implementation has nothing to do
+		virtual void sync();
 	};
 
+	// Any number of read-only Mappings, or one writable one, may use the file at a time.
+	// Thread holding the writable one may map the file again; thread holding a read-only one
+	// gets MappingUpgrade asking for a writable one. Waiting writers go before new readers,
+	// except threads reading already.
 	class MappedFile {
-		std::recursive_mutex mutex;
+		std::mutex mutex;
+		std::condition_variable released;
+		std::thread::id writer;
+		size_t writes = 0;
+		size_t waitingWriters = 0;
+		std::unordered_map<std::thread::id, size_t> readers; // shared locks held by each thread
+
+		void lock(bool exclusive);
+		// holder is the thread that took the lock
+		void unlock(bool exclusive, std::thread::id holder);
 	public:
+		// Held by drivers while they move the mapping, like a writable Mapping
+		class Exclusive {
+			std::shared_ptr<MappedFile> file;
+		public:
+			explicit Exclusive(const std::shared_ptr<MappedFile> &file);
+			Exclusive(const Exclusive &) = delete;
+			Exclusive &operator=(const Exclusive &) = delete;
+			~Exclusive();
+		};
+
 		virtual ~MappedFile() = 0;
 		virtual void *get() = 0;
 		virtual size_t size() = 0;
 		virtual void resize(size_t size) = 0;
+		// Reserves address range for the file to grow in; get() stays the same while the file
+		// is resized within capacity. Drivers which cannot do that report the current size.
+		virtual size_t capacity();
+		virtual void reserve(size_t capacity);
+		// Length of zero means up to end of mapping. Default implementations ignore advice
+		// and do not populate anything.
+		virtual void advise(Advice advice, size_t offset, size_t length);
+		// faults all pages in ahead of use
+		virtual void populate();
+		// Writes range of the mapping back to the file; synchronous flush returns once it is
+		// durable, asynchronous one only schedules it. Length of zero means up to end of mapping.
+		virtual void flush(size_t offset, size_t length, bool async);
 
 		friend class VFS::Mapping;
 	};
 
+	// Range of a file mapped on its own. It may reach past end of file; size() tells how much
+	// of it is backed by the file at the moment, so file can be resized while it exists.
+	class MappedWindow {
+	public:
+		virtual ~MappedWindow() = 0;
+		// address of byte at offset()
+		virtual void *get() = 0;
+		virtual uintmax_t offset() = 0;
+		virtual size_t length() = 0;
+		virtual size_t size() = 0;
+		// same length at another offset
+		virtual void move(uintmax_t offset) = 0;
+		// default implementation ignores advice
+		virtual void advise(Advice advice);
+		virtual void flush(bool async);
+	};
+
+	// Metadata of an element, drivers fill in whatever they can get cheaply
+	class Attributes {
+	public:
+		enum class Kind {
+			Unknown,
+			File,
+			Directory,
+			Symlink,
+			Other
+		};
+
+		// identifies the underlying element, whatever name it is reached with
+		struct Identity {
+			uint64_t device;
+			uint64_t inode;
+
+			bool operator==(const Identity &other) const;
+			bool operator!=(const Identity &other) const;
+		};
+
+		Kind kind = Kind::Unknown;
+		boost::optional<uintmax_t> size;
+		boost::optional<std::chrono::system_clock::time_point> modificationTime;
+		boost::optional<Identity> identity;
+
+		Attributes() = default;
+		explicit Attributes(Kind kind);
+		bool complete() const;
+	};
+
 	class FileEntry {
 	public:
 		FileEntry(const std::string &fileName, bool directory);
+		FileEntry(const std::string &fileName, const Attributes &attributes);
 
 		std::string fileName;
 		bool directory;
+		Attributes attributes;
+	};
+
+	// Entries of a directory with all names stored back to back in a single buffer. Big
+	// directories may be listed in pages, every listDirectory() call continues from
+	// resumeToken() and complete() tells whether anything is left. Drivers that cannot
+	// express their position as a token keep it in cursor(), which copies of a suspended
+	// listing share and which is released once the listing is finished or rewound.
+	class Listing {
+	public:
+		typedef uint64_t ResumeToken;
+
+	private:
+		struct Entry {
+			size_t offset;
+			size_t size;
+			bool directory;
+		};
+
+		std::string names;
+		std::vector<Entry> entries;
+		// filled only by drivers that have them at hand while listing
+		std::vector<Attributes> _attributes;
+		ResumeToken _resumeToken = 0;
+		std::shared_ptr<void> _cursor;
+		bool _complete = false;
+
+		void fillAttributes();
+
+	public:
+		size_t size() const;
+		bool empty() const;
+		// names are null terminated
+		const char *nameData(size_t i) const;
+		size_t nameSize(size_t i) const;
+		std::string name(size_t i) const;
+		bool directory(size_t i) const;
+		const Attributes &attributes(size_t i) const;
+		FileEntry entry(size_t i) const;
+
+		void append(const char *name, size_t size, bool directory);
+		void append(const char *name, size_t size, const Attributes &attributes);
+		void setAttributes(size_t i, const Attributes &attributes);
+		void reserve(size_t entries, size_t namesSize);
+		void clear(); // drops entries, but keeps position
+
+		ResumeToken resumeToken() const;
+		const std::shared_ptr<void> &cursor() const;
+		bool complete() const;
+		void suspend(ResumeToken token, const std::shared_ptr<void> &cursor = nullptr); // more entries follow token
+		void finish(); // no more entries
+		void rewind();
+	};
+
+	// One read of a batch, fills buffer with content of file at path starting at offset
+	struct ReadRequest {
+		Path path;
+		uintmax_t offset = 0;
+		Buffer buffer{nullptr, 0};
+		size_t transferred = 0; // bytes read, less than buffer size at end of file
+		std::exception_ptr error; // set if this request failed
+	};
+
+	// Read-only bytes of a file, valid as long as owner exists
+	struct ViewedRange {
+		std::shared_ptr<const void> owner;
+		const void *data = nullptr;
+		size_t size = 0;
 	};
 
 	explicit Driver(const std::string &name);
 	virtual ~Driver() = 0;
 	virtual FileEntry get(const Path &path) = 0;
+	// like get(), but returns nothing instead of throwing ElementNotFound
+	virtual boost::optional<FileEntry> tryGet(const Path &path);
+	bool exists(const Path &path);
 	virtual std::vector<FileEntry> listDirectory(const Path &path) = 0;
+	// only entries with names matching filter; drivers able to skip other ones natively
+	// should override it, default implementation filters the full listing
+	virtual std::vector<FileEntry> listDirectory(const Path &path, const NamePattern &filter);
+	// Replaces content of listing with at most limit entries (all if zero) matching filter,
+	// continuing from its resume token. Default implementation pages through the vector
+	// returned by listDirectory(path, filter), so it is worth overriding in drivers.
+	virtual void listDirectory(const Path &path, Listing &listing, size_t limit = 0,
+		const NamePattern &filter = NamePattern());
 	virtual uintmax_t size(const Path &path) = 0;
 	virtual void resize(const Path &path, uintmax_t size) = 0;
 	virtual void createFile(const Path &path) = 0;
@@ -69,10 +277,45 @@ public:
 	virtual void removeDirectory(const Path &path) = 0;
 	virtual std::shared_ptr<OpenFile> open(const Path &path) = 0;
 	virtual std::shared_ptr<MappedFile> map(const Path &path) = 0;
+	// Default implementation points into mapping of the whole file, so address of a window
+	// may change when the file is resized.
+	virtual std::shared_ptr<MappedWindow> mapWindow(const Path &path, uintmax_t offset, size_t length,
+		bool writable, bool populate = false);
+	// At most length bytes of file at path starting at offset, fewer at end of file. Default
+	// implementation copies them to a buffer owned by the range; drivers able to lend their own
+	// memory override it.
+	virtual ViewedRange view(const Path &path, uintmax_t offset, size_t length);
+	// Completes all requests, with at most queueDepth of them in progress at a time; failure
+	// of one request does not affect other ones. Default implementation opens and reads
+	// files on threads of pool.
+	virtual void readMany(std::vector<ReadRequest> &requests, ThreadPool &pool, size_t queueDepth);
+
+	// Asynchronous variants of operations. Default implementations run synchronous ones on
+	// executor; drivers able to do better natively, or never blocking, override them.
+	virtual Task<FileEntry> getAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<std::vector<FileEntry>> listDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor);
+	virtual Task<uintmax_t> sizeAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<void> resizeAsync(const Path &path, uintmax_t size, const std::shared_ptr<Executor> &executor);
+	virtual Task<void> createFileAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<void> removeFileAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<void> createDirectoryAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<void> removeDirectoryAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<std::shared_ptr<OpenFile>> openAsync(const Path &path, const std::shared_ptr<Executor> &executor);
+	virtual Task<size_t> readAsync(const Path &path, uintmax_t pos, const Buffer &buffer,
+		const std::shared_ptr<Executor> &executor);
+	virtual Task<size_t> writeAsync(const Path &path, uintmax_t pos, const ConstBuffer &buffer,
+		const std::shared_ptr<Executor> &executor);
 
 	void registerMountPoint(const std::shared_ptr<Directory> &directory);
 	void unregisterMountPoint(const std::shared_ptr<Directory> &directory);
 
+protected:
+	// at most length bytes of file from offset, copied to a buffer owned by the range
+	static ViewedRange copyRange(OpenFile &file, uintmax_t offset, size_t length);
+
+public:
+
 	friend Utility::Logger::Stream &operator<<(Utility::Logger::Stream &stream,
 		const Driver &driver);
 };
@@ -80,6 +80,23 @@ public:
 	AlreadyOpened();
 };
 
+class TIALVFS_EXPORT ReadOnlyAccessor: public Exception {
+	std::string accessorType;
+public:
+	explicit ReadOnlyAccessor(const std::string &accessorType);
+};
+
+class TIALVFS_EXPORT MappingUpgrade: public Exception {
+public:
+	MappingUpgrade();
+};
+
+class TIALVFS_EXPORT FileViewed: public Exception {
+	Path path;
+public:
+	explicit FileViewed(const Path &path);
+};
+
 }
 
 }
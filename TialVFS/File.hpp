@@ -1,6 +1,8 @@
 #pragma once
 #include "TialVFSExport.hpp"
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include "Object.hpp"
 #include "Driver.hpp"
 
@@ -15,10 +17,11 @@ class Stream;
 
 class TIALVFS_EXPORT FileDevice {
 	std::shared_ptr<Driver::OpenFile> file;
+	std::weak_ptr<File> owner;
 	mutable std::streampos pos = 0;
 
 	FileDevice() = default;
-	explicit FileDevice(const std::shared_ptr<Driver::OpenFile> &file);
+	FileDevice(const std::shared_ptr<Driver::OpenFile> &file, const std::weak_ptr<File> &owner);
 public:
 	typedef char char_type;
 	typedef boost::iostreams::seekable_device_tag category;
@@ -34,8 +37,10 @@ public:
 
 class TIALVFS_EXPORT Stream: public boost::iostreams::stream<FileDevice> {
 	FileDevice _device;
+	size_t _bufferSize = 0;
 
-	Stream(const std::shared_ptr<Driver::OpenFile> &file, intmax_t offset, std::ios_base::seekdir direction);
+	Stream(const std::shared_ptr<Driver::OpenFile> &file, const std::weak_ptr<File> &owner,
+		intmax_t offset, std::ios_base::seekdir direction, size_t bufferSize);
 	const FileDevice *operator->() const;
 	void open(const FileDevice &device);
 public:
@@ -43,19 +48,63 @@ public:
 	Stream(const Stream &other);
 	Stream &operator=(const Stream &other);
 	std::streamsize size() const;
+	// zero if default one of boost::iostreams is used
+	size_t bufferSize() const;
+	// length of zero means up to end of file
+	void advise(Driver::Advice advice, uintmax_t offset = 0, uintmax_t length = 0);
+
+	friend class File;
+};
+
+// Positional access to an open file, with no buffer or position of its own. Every call
+// transfers one range straight through the driver, so a Handle may be shared by threads
+// if the driver allows concurrent access to a file.
+class TIALVFS_EXPORT Handle {
+	std::shared_ptr<Driver::OpenFile> file;
+	std::weak_ptr<File> owner;
+
+	Handle(const std::shared_ptr<Driver::OpenFile> &file, const std::weak_ptr<File> &owner);
+	const std::shared_ptr<Driver::OpenFile> &checked() const;
+public:
+	Handle() = default;
+
+	// return number of bytes transferred, reads stop early at end of file
+	size_t read(uintmax_t pos, const Driver::Buffer &buffer) const;
+	size_t write(uintmax_t pos, const Driver::ConstBuffer &buffer) const;
+	size_t read(uintmax_t pos, const std::vector<Driver::Buffer> &buffers) const;
+	size_t write(uintmax_t pos, const std::vector<Driver::ConstBuffer> &buffers) const;
+	uintmax_t size() const;
+
+	bool assigned() const;
+	operator bool() const;
+	bool operator!() const;
 
 	friend class File;
 };
 
 class TIALVFS_EXPORT Mapping {
+public:
+	// Read-only mappings of a file coexist, writable one is exclusive. Read-only ones must not
+	// be written through, and cannot be resized.
+	enum class Access {
+		ReadOnly,
+		ReadWrite
+	};
+
+private:
 	std::shared_ptr<Driver::MappedFile> file;
-	std::unique_lock<std::recursive_mutex> lock;
+	Access _access = Access::ReadWrite;
+	std::weak_ptr<File> owner;
+	std::thread::id holder; // mapping may be released by another thread than the one locking it
 
-	explicit Mapping(const std::shared_ptr<File> &file);
+	Mapping(const std::shared_ptr<File> &file, Access access, bool populate);
+	void release();
+	void checkWritable() const;
 public:
 	Mapping() = default;
 	Mapping(const Mapping &) = delete;
 	Mapping(Mapping &&) = default;
+	~Mapping();
 
 	Mapping &operator=(const Mapping &) = delete;
 	Mapping &operator=(Mapping &&);
@@ -64,6 +113,61 @@ public:
 	void resize(size_t size);
 	void *get() const;
 
+	// Address returned by get() stays the same while file is resized within capacity,
+	// so data can be appended to a mapped file cheaply. Reserving may move the mapping.
+	size_t capacity() const;
+	void reserve(size_t capacity);
+
+	// length of zero means up to end of mapping
+	void advise(Driver::Advice advice, size_t offset = 0, size_t length = 0);
+	// synchronous flush returns once range is durable, asynchronous one only starts writing it
+	void flush(size_t offset = 0, size_t length = 0, bool async = false);
+
+	template<typename T>
+	T *as() {
+		return reinterpret_cast<T*>(get());
+	}
+
+	template<typename T>
+	const T *as() const {
+		return reinterpret_cast<T*>(get());
+	}
+
+	Access access() const;
+	bool assigned() const;
+	operator bool() const;
+	bool operator!() const;
+
+	friend class File;
+};
+
+// Range of a file mapped on its own, for files too large to be mapped whole. Any offset may
+// be used, alignment to pages is handled inside. Windows of a file are independent of each other
+// and of Mappings, they stay usable when the file is resized; size() tells how much of the window
+// is within the file at the moment.
+class TIALVFS_EXPORT Window {
+	std::shared_ptr<Driver::MappedWindow> window;
+	Mapping::Access _access = Mapping::Access::ReadWrite;
+	std::weak_ptr<File> owner;
+
+	Window(const std::shared_ptr<File> &file, uintmax_t offset, size_t length, Mapping::Access access,
+		bool populate);
+	void release();
+	const std::shared_ptr<Driver::MappedWindow> &checked() const;
+public:
+	Window() = default;
+	Window(const Window &) = delete;
+	Window(Window &&) = default;
+	~Window();
+
+	Window &operator=(const Window &) = delete;
+	Window &operator=(Window &&);
+
+	uintmax_t offset() const;
+	size_t length() const;
+	size_t size() const;
+	void *get() const;
+
 	template<typename T>
 	T *as() {
 		return reinterpret_cast<T*>(get());
@@ -74,6 +178,17 @@ public:
 		return reinterpret_cast<T*>(get());
 	}
 
+	// Sliding helpers. next() moves window right past its end and tells if it still covers
+	// some of the file; at() moves the window only if range is not within it already.
+	void move(uintmax_t offset);
+	bool next();
+	bool contains(uintmax_t position, size_t length) const;
+	void *at(uintmax_t position, size_t length);
+
+	void advise(Driver::Advice advice);
+	void flush(bool async = false);
+
+	Mapping::Access access() const;
 	bool assigned() const;
 	operator bool() const;
 	bool operator!() const;
@@ -81,23 +196,91 @@ public:
 	friend class File;
 };
 
+// Read-only bytes of a file, lent by the driver where it can do that and copied otherwise.
+// Copies of a View share the same bytes, which stay valid as long as any of them exists and
+// the file is not shrunk below them; resize() through the driver fails with FileViewed then,
+// but a file truncated behind it may fault when a lent view is read (SIGBUS with
+// NativeFSDriver). Whether later writes to the range are seen depends on the driver.
+class TIALVFS_EXPORT View {
+	Driver::ViewedRange range;
+
+	explicit View(const Driver::ViewedRange &range);
+public:
+	View() = default;
+
+	const void *data() const;
+	size_t size() const;
+	bool empty() const;
+	const char *begin() const;
+	const char *end() const;
+
+	template<typename T>
+	const T *as() const {
+		return reinterpret_cast<const T*>(data());
+	}
+
+	friend class File;
+};
+
+// Attributes of the file are cached for as long as it stays Valid, so repeated
+// size() calls do not reach the driver. Writes done through streams and mappings
+// of this file drop cached size and modification time.
 class TIALVFS_EXPORT File: public Object {
+	std::mutex attributesMutex;
+	Driver::Attributes _attributes;
+
 	File(const std::shared_ptr<Root> &root, const std::shared_ptr<Directory> &parent, const std::string &name);
 	std::shared_ptr<Driver::OpenFile> _open();
 	std::shared_ptr<Driver::MappedFile> _map();
+	std::shared_ptr<Driver::MappedWindow> _mapWindow(uintmax_t offset, size_t length, bool writable,
+		bool populate);
 	virtual void validate() override;
+	void setAttributes(const Driver::Attributes &attributes);
+	void attributesChanged();
 public:
-	Stream open(intmax_t offset = 0, std::ios_base::seekdir direction = std::ios_base::beg);
-	Mapping map();
+	// buffer size of zero leaves default of boost::iostreams
+	Stream open(intmax_t offset = 0, std::ios_base::seekdir direction = std::ios_base::beg,
+		size_t bufferSize = 0);
+	Handle handle();
+	// one-off positional transfers; for many of them a Handle saves looking up the descriptor
+	size_t read(uintmax_t pos, const Driver::Buffer &buffer);
+	size_t write(uintmax_t pos, const Driver::ConstBuffer &buffer);
+	// populate faults in all pages of the mapping up front
+	Mapping map(Mapping::Access access = Mapping::Access::ReadWrite, bool populate = false);
+	Window map(uintmax_t offset, size_t length, Mapping::Access access = Mapping::Access::ReadWrite,
+		bool populate = false);
 
+	// At most length bytes starting at offset, without copying them where the driver allows;
+	// fewer at end of file, none past it.
+	View view(uintmax_t offset, size_t length);
+
+	// Advice is given to the descriptor shared by all streams of the file, where the driver
+	// has one. Length of zero means up to end of file.
+	void advise(Driver::Advice advice, uintmax_t offset = 0, uintmax_t length = 0);
+	// Returns once data written to the file is durable. Streams have to be flushed before,
+	// their buffers are not seen by the driver.
+	void sync();
+
+	Driver::Attributes attributes();
 	uintmax_t size();
 	void resize(uintmax_t size);
 
+	// Asynchronous variants run on executor of the root. Reads and writes of a Valid file go
+	// straight to the driver, so drivers with native asynchronous operations take no thread.
+	Task<Stream> openAsync(intmax_t offset = 0, std::ios_base::seekdir direction = std::ios_base::beg);
+	Task<size_t> readAsync(uintmax_t pos, const Driver::Buffer &buffer);
+	Task<size_t> writeAsync(uintmax_t pos, const Driver::ConstBuffer &buffer);
+	Task<uintmax_t> sizeAsync();
+	Task<void> resizeAsync(uintmax_t size);
+
 	virtual void remove() override;
 
 	friend class FileDevice;
+	friend class Handle;
 	friend class Mapping;
+	friend class Window;
 	friend class Directory;
+	friend class Root;
 };
 
 }
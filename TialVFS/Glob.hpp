@@ -0,0 +1,62 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Common.hpp"
+#include "Directory.hpp"
+#include "NamePattern.hpp"
+
+namespace Tial {
+namespace VFS {
+
+class Object;
+class TaskGroup;
+
+// Path pattern compiled once and matched against directory trees. Literal segments are
+// looked up directly in directory tables, other ones are compiled to NamePatterns.
+// "**" matches one or more levels of directories. All segments are tracked as a set of states while walking
+// the tree, so every directory is visited at most once, whatever the pattern.
+class TIALVFS_EXPORT Glob {
+	struct Segment {
+		bool recursive;
+		NamePattern name;
+	};
+
+	struct Context {
+		std::vector<std::shared_ptr<Object>> results;
+		std::mutex mutex;
+		size_t limit;
+		std::atomic<bool> stopped{false};
+		TaskGroup *group = nullptr;
+	};
+
+	static const size_t maxSegments = 63;
+
+	Path _pattern;
+	std::vector<Segment> segments;
+
+	uint64_t accepting() const;
+	bool literalsOnly(uint64_t states) const;
+	uint64_t transitions(uint64_t states, const std::string &name, bool caseSensitive) const;
+	void match(Directory &directory, uint64_t states, Context &context) const;
+	void visit(const std::shared_ptr<Object> &object, uint64_t states, Context &context) const;
+
+public:
+	explicit Glob(const Path &pattern);
+
+	const Path &pattern() const;
+
+	// limit of zero means all matches; order of results is unspecified
+	std::vector<std::shared_ptr<Object>> match(const std::shared_ptr<Directory> &directory, size_t limit = 0,
+		Directory::Traversal traversal = Directory::Traversal::DepthFirst) const;
+	std::shared_ptr<Object> first(const std::shared_ptr<Directory> &directory) const;
+};
+
+}
+}
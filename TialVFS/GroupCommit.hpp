@@ -0,0 +1,52 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Async.hpp"
+
+namespace Tial {
+namespace VFS {
+
+class File;
+
+// Makes writes of many threads durable together. Every request completes once everything
+// written to the file before it was made is durable, while a single syncer thread calls
+// File::sync() once for all requests gathered during the previous one.
+class TIALVFS_EXPORT GroupCommit {
+	std::function<void()> commit;
+	std::mutex mutex;
+	std::condition_variable requested;
+	std::vector<Promise<void>> pending;
+	bool stopping = false;
+	std::atomic<uintmax_t> _requests{0};
+	std::atomic<uintmax_t> _batches{0};
+	std::thread syncer;
+
+	void run();
+
+public:
+	explicit GroupCommit(const std::shared_ptr<File> &file);
+	// for anything else; function makes durable whatever was written before it was called
+	explicit GroupCommit(std::function<void()> commit);
+	GroupCommit(const GroupCommit &) = delete;
+	GroupCommit &operator=(const GroupCommit &) = delete;
+	// completes requests made so far before returning
+	~GroupCommit();
+
+	// waits for durability, rethrows failure of the batch
+	void sync();
+	Task<void> syncAsync();
+
+	uintmax_t requests() const;
+	uintmax_t batches() const;
+};
+
+}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Common.hpp"
+
+namespace Tial {
+namespace VFS {
+
+class Object;
+
+// Maps (base directory, normalized relative path) to resolved object, so repeated lookups
+// of the same path take a single hash probe instead of a walk through every level.
+// Paths known not to exist are remembered too, in a separate bounded table.
+// Coherence is epoch based: every invalidation in the tree bumps the epoch, creation of
+// new entries bumps the negative epoch, and entries stamped with older ones are misses.
+class TIALVFS_EXPORT LookupCache {
+public:
+	struct Statistics {
+		uintmax_t hits = 0;
+		uintmax_t negativeHits = 0;
+		uintmax_t misses = 0;
+	};
+
+	struct Stamp {
+		uintmax_t epoch;
+		uintmax_t negativeEpoch;
+	};
+
+private:
+	struct Key {
+		const Object *base;
+		std::string path;
+
+		bool operator==(const Key &other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	struct Entry {
+		std::weak_ptr<Object> base;
+		std::weak_ptr<Object> object;
+		Stamp stamp;
+	};
+
+	mutable std::mutex mutex;
+	std::unordered_map<Key, Entry, KeyHash> entries;
+	std::unordered_map<Key, Entry, KeyHash> negativeEntries;
+	size_t _capacity;
+	size_t _negativeCapacity;
+	std::atomic<uintmax_t> _epoch{0};
+	std::atomic<uintmax_t> _negativeEpoch{0};
+	std::atomic<uintmax_t> _hits{0};
+	std::atomic<uintmax_t> _negativeHits{0};
+	std::atomic<uintmax_t> _misses{0};
+
+public:
+	explicit LookupCache(size_t capacity = 65536, size_t negativeCapacity = 16384);
+	LookupCache(const LookupCache &) = delete;
+	LookupCache &operator=(const LookupCache &) = delete;
+
+	// true if the answer is cached, object is null for paths known not to exist
+	bool find(const Object &base, const std::string &path, std::shared_ptr<Object> &object);
+	void insert(const std::shared_ptr<Object> &base, const std::string &path,
+		const std::shared_ptr<Object> &object, const Stamp &stamp);
+
+	Stamp stamp() const;
+	void invalidate();
+	void invalidateNegative();
+	void clear();
+
+	size_t capacity() const;
+	void setCapacity(size_t capacity);
+	size_t negativeCapacity() const;
+	void setNegativeCapacity(size_t capacity);
+
+	Statistics statistics() const;
+	void resetStatistics();
+};
+
+}
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "TialVFSExport.hpp"
 
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 
@@ -16,15 +17,25 @@ protected:
 	class Node {
 		bool directory = false;
 		std::unordered_map<std::string, std::shared_ptr<Node>> elements;
-		std::vector<uint8_t> data;
+		// shared with views of the file, see resizable()
+		std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>();
 		std::shared_ptr<MemoryMappedFile> mapping;
+		std::chrono::system_clock::time_point modificationTime = std::chrono::system_clock::now();
 	public:
 		explicit Node(bool directory);
-		FileEntry get(const Path &path);
+		Attributes attributes(uint64_t device) const;
+		void modified();
+		FileEntry get(const Path &path, uint64_t device);
 		std::shared_ptr<Node> getNode(const Path &path);
-		std::vector<FileEntry> listDirectory(const Path &path);
+		std::shared_ptr<Node> findNode(const Path &path);
+		void listDirectory(const Path &path, Listing &listing, size_t limit, const NamePattern &filter,
+			uint64_t device);
 		void createNode(const Path &path, bool directory);
 		void removeNode(const Path &path);
+		// data is always resident, only huge pages make a difference
+		void advise(Advice advice, uintmax_t offset, uintmax_t length);
+		// data about to hold size bytes; replaced by a copy first if that reallocates it while viewed
+		std::vector<uint8_t> &resizable(size_t size);
 
 		friend class MemoryOpenFile;
 		friend class MemoryDriver;
@@ -32,6 +43,8 @@ protected:
 
 	std::shared_ptr<Node> root = std::make_shared<Node>(true);
 
+	uint64_t device() const;
+
 	class MemoryOpenFile: public Driver::OpenFile {
 		std::shared_ptr<Node> node;
 
@@ -39,7 +52,10 @@ protected:
 	public:
 		virtual size_t read(size_t pos, void *buffer, size_t bufferSize) override;
 		virtual size_t write(size_t pos, const void *buffer, size_t bufferSize) override;
+		virtual size_t readv(size_t pos, const std::vector<Buffer> &buffers) override;
+		virtual size_t writev(size_t pos, const std::vector<ConstBuffer> &buffers) override;
 		virtual size_t size() override;
+		virtual void advise(Advice advice, uintmax_t offset, uintmax_t length) override;
 
 		friend class MemoryDriver;
 	};
@@ -52,6 +68,9 @@ protected:
 		virtual void *get() override;
 		virtual size_t size() override;
 		virtual void resize(size_t size) override;
+		virtual size_t capacity() override;
+		virtual void reserve(size_t capacity) override;
+		virtual void advise(Advice advice, size_t offset, size_t length) override;
 
 		friend class MemoryDriver;
 	};
@@ -59,7 +78,11 @@ protected:
 public:
 	MemoryDriver(const std::string &name = "memory");
 	virtual FileEntry get(const Path &path) override;
+	virtual boost::optional<FileEntry> tryGet(const Path &path) override;
 	virtual std::vector<FileEntry> listDirectory(const Path &path) override;
+	virtual std::vector<FileEntry> listDirectory(const Path &path, const NamePattern &filter) override;
+	virtual void listDirectory(const Path &path, Listing &listing, size_t limit = 0,
+		const NamePattern &filter = NamePattern()) override;
 	virtual uintmax_t size(const Path &path) override;
 	virtual void resize(const Path &path, uintmax_t size) override;
 	virtual void createFile(const Path &path) override;
@@ -68,6 +91,30 @@ public:
 	virtual void removeDirectory(const Path &path) override;
 	virtual std::shared_ptr<OpenFile> open(const Path &path) override;
 	virtual std::shared_ptr<MappedFile> map(const Path &path) override;
+	// Lends the buffer of file. Views see writes, and bytes left past the end when the file
+	// shrinks stay allocated; growing beyond capacity leaves views the old buffer.
+	virtual ViewedRange view(const Path &path, uintmax_t offset, size_t length) override;
+
+	// Memory operations never block, so asynchronous variants of the driver complete on the
+	// calling thread. Asynchronous operations of Directory, Object and of files not Valid yet
+	// still call the driver from threads of the executor; nothing in the driver is locked, so
+	// they must not change it while other threads use it.
+	virtual Task<FileEntry> getAsync(const Path &path, const std::shared_ptr<Executor> &executor) override;
+	virtual Task<std::vector<FileEntry>> listDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) override;
+	virtual Task<uintmax_t> sizeAsync(const Path &path, const std::shared_ptr<Executor> &executor) override;
+	virtual Task<void> resizeAsync(const Path &path, uintmax_t size,
+		const std::shared_ptr<Executor> &executor) override;
+	virtual Task<void> createFileAsync(const Path &path, const std::shared_ptr<Executor> &executor) override;
+	virtual Task<void> removeFileAsync(const Path &path, const std::shared_ptr<Executor> &executor) override;
+	virtual Task<void> createDirectoryAsync(const Path &path, const std::shared_ptr<Executor> &executor) override;
+	virtual Task<void> removeDirectoryAsync(const Path &path, const std::shared_ptr<Executor> &executor) override;
+	virtual Task<std::shared_ptr<OpenFile>> openAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) override;
+	virtual Task<size_t> readAsync(const Path &path, uintmax_t pos, const Buffer &buffer,
+		const std::shared_ptr<Executor> &executor) override;
+	virtual Task<size_t> writeAsync(const Path &path, uintmax_t pos, const ConstBuffer &buffer,
+		const std::shared_ptr<Executor> &executor) override;
 };
 
 }
@@ -0,0 +1,49 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <string>
+#include <vector>
+
+#include "Common.hpp"
+
+namespace Tial {
+namespace VFS {
+
+// Compiled pattern for a single name (one path segment). Literal names and prefixes are
+// compared directly, patterns with only '*' and '?' are split into chunks matched without
+// backtracking, any other syntax is left to Utility::Wildcards.
+class TIALVFS_EXPORT NamePattern {
+public:
+	enum class Kind {
+		Any,
+		Literal,
+		Prefix,
+		Wildcard,
+		Pattern
+	};
+
+private:
+	Kind _kind = Kind::Any;
+	std::string _text;
+	bool _caseSensitive = true;
+	// pieces between stars, for Wildcard patterns
+	std::vector<std::string> chunks;
+	bool anchoredStart = true;
+	bool anchoredEnd = true;
+
+public:
+	NamePattern() = default;
+	explicit NamePattern(const std::string &pattern, bool caseSensitive = true);
+	static NamePattern prefix(const std::string &prefix, bool caseSensitive = true);
+
+	Kind kind() const;
+	const std::string &text() const;
+	bool caseSensitive() const;
+	void setCaseSensitive(bool caseSensitive);
+
+	bool matches(const std::string &name) const;
+	bool matches(const std::string &name, bool caseSensitive) const;
+};
+
+}
+}
@@ -5,6 +5,11 @@
 #include "Exception.hpp"
 #include <TialUtility/TialUtility.hpp>
 
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <set>
 #include <unordered_map>
 
 #include <boost/predef.h>
@@ -15,13 +20,116 @@ namespace Tial {
 namespace VFS {
 
 class TIALVFS_EXPORT NativeFSDriver: public Driver {
+public:
+	// how directories are read; GetDents reads batches of raw entries and is available
+	// on Linux only, ReadDir goes through the C library one entry at a time and keeps the
+	// directory stream open in a listing suspended between pages
+	enum class Scanner {
+		ReadDir,
+		GetDents
+	};
+
+	struct CacheStatistics {
+		uintmax_t hits = 0;
+		uintmax_t misses = 0;
+		uintmax_t evictions = 0;
+	};
+	typedef CacheStatistics DirectoryCacheStatistics;
+	typedef CacheStatistics DescriptorCacheStatistics;
+
+private:
+	static const size_t scanBufferSize = 64*1024;
+
 	Utility::NativePath nativeDirectory;
+	Scanner _scanner;
 
 	static std::string _prepareName(const std::string &name, const Utility::NativePath nativeDirectory);
+
+	// Descriptor of the mount root and an LRU cache of descriptors of directories below it.
+	// Operations are done relative to the descriptor of the parent directory, so the kernel
+	// resolves only the last component of a path and no native path string is built.
+	class DirectoryDescriptors {
+	public:
+		// stays open while used, even if evicted from the cache in the meantime
+		class Descriptor {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+			int fd;
+#else
+#error "Platform not supported"
+#endif
+		public:
+			explicit Descriptor(int fd);
+			Descriptor(const Descriptor &) = delete;
+			Descriptor &operator=(const Descriptor &) = delete;
+			~Descriptor();
+			int get() const;
+		};
+
+	private:
+		typedef std::list<std::pair<std::string, std::shared_ptr<Descriptor>>> Entries;
+
+		const Utility::NativePath &nativeDirectory;
+		mutable std::mutex mutex;
+		std::shared_ptr<Descriptor> root;
+		Entries entries; // most recently used first
+		std::unordered_map<std::string, Entries::iterator> index;
+		size_t _capacity;
+		DirectoryCacheStatistics _statistics;
+
+		void evict();
+
+	public:
+		DirectoryDescriptors(const Utility::NativePath &nativeDirectory, size_t capacity);
+
+		// null with errno set if directory cannot be opened, cached is set if it came from the cache
+		std::shared_ptr<Descriptor> get(const Path &path, bool &cached);
+		// Checks cached descriptors that path is resolved from against directories at their paths
+		// now. Stale ones are dropped with everything below them and true is returned.
+		bool stale(const Path &path);
+		// drops directory at path and everything below it
+		void forget(const Path &path);
+		void clear();
+
+		size_t capacity() const;
+		void setCapacity(size_t capacity);
+		DirectoryCacheStatistics statistics() const;
+	};
+
+	DirectoryDescriptors directories;
+
+	// Calls operation(directory descriptor, name) for parent directory and last component of
+	// path, and returns its result; -1 with errno set means failure. When it fails with ENOENT
+	// or ENOTDIR under a cached directory, that directory is checked, and if it was removed or
+	// replaced in the meantime, it is dropped and the operation retried once. A cached directory
+	// renamed behind the driver still accepts operations, so for verified ones (those changing
+	// something, or opening files to write) it is checked before the operation instead.
+	int at(const Path &path, const std::function<int(int, const char*)> &operation, bool verified = false);
+
+	// cleared when io_uring turns out not to be usable, batches use thread pool from then on
+	std::atomic<bool> ringAvailable{true};
+	// io_uring instance kept between batches, for the queue depth it was set up with; batches
+	// running while it is in use set up their own
+	std::mutex ringMutex;
+	std::shared_ptr<void> ring;
+	size_t ringDepth = 0;
+
+	// io_uring of asynchronous reads and writes, set up on first use, with a thread of its own
+	// waiting for completions
+	static const unsigned asyncRingEntries = 256;
+	std::mutex asyncRingMutex;
+	std::shared_ptr<void> asyncRing;
+	bool asyncRingAvailable = true;
+	// invalid Task if io_uring is not usable, nothing is done then
+	Task<size_t> transferAsync(const Path &path, uintmax_t pos, void *data, size_t size, bool write,
+		const std::shared_ptr<Executor> &executor);
+	// returns false if io_uring is not usable; requests are untouched then
+	bool readManyRing(std::vector<ReadRequest> &requests, ThreadPool &pool, size_t queueDepth);
+
+	// Descriptors are owned by the driver, users get pointers that keep the driver alive
 	class NativeFileDescriptor {
 	protected:
-		std::shared_ptr<NativeFSDriver> driver;
-		Utility::NativePath nativePath;
+		NativeFSDriver *driver;
+		Path path;
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 		int fd = -1;
 #else
@@ -29,59 +137,89 @@ class TIALVFS_EXPORT NativeFSDriver: public Driver {
 #endif
 
 		NativeFileDescriptor(
-			const std::shared_ptr<NativeFSDriver> &driver,
-			const Utility::NativePath &nativePath,
+			NativeFSDriver *driver,
+			const Path &path,
 			bool openAutomatically = true
 		);
 		virtual ~NativeFileDescriptor();
 		virtual void descriptorOpen();
 		virtual void descriptorClose();
+		// taken from the idle list, file could have changed since
+		virtual void descriptorReused();
+		// whether path still names the opened file
+		bool current() const;
 		size_t size() const;
 
 		friend class NativeFSDriver;
 	};
 
-	std::recursive_mutex openDescriptorsMutex;
-	std::unordered_multimap<Utility::NativePath, std::weak_ptr<NativeFileDescriptor>> openDescriptors;
+	// Descriptor of a file is shared by everyone who opens it. When the last user is gone it
+	// stays open on the idle list, so opening the file again takes a few stat calls instead
+	// of open; the list is trimmed to capacity in LRU order. Lookup, release and eviction take
+	// constant time. Idle descriptor is reused only if the path still names the same file,
+	// one of a file removed or replaced behind the driver is dropped.
+	typedef std::list<std::pair<size_t, std::string>> IdleDescriptors;
+
+	struct OpenDescriptor {
+		std::shared_ptr<NativeFileDescriptor> descriptor;
+		std::weak_ptr<NativeFileDescriptor> user; // expired while idle
+		bool idle = false;
+		IdleDescriptors::iterator position;
+	};
+
+	static const size_t descriptorKinds = 2;
+
+	mutable std::recursive_mutex openDescriptorsMutex;
+	std::unordered_map<std::string, OpenDescriptor> openDescriptors[descriptorKinds];
+	IdleDescriptors idleDescriptors; // most recently used first
+	size_t _descriptorCacheCapacity = 64;
+	DescriptorCacheStatistics _descriptorCacheStatistics;
+
+	std::shared_ptr<NativeFileDescriptor> acquire(size_t kind, const Path &path,
+		const std::function<std::shared_ptr<NativeFileDescriptor>()> &create);
+	void release(size_t kind, const std::string &path, const std::shared_ptr<NativeFileDescriptor> &descriptor);
+	void evictDescriptors();
+	// next open of path gets a new descriptor; current users keep the old one
+	void forgetDescriptors(const Path &path);
+
+	// take ownership of fd, which must be a readable descriptor of the directory; readDirectory()
+	// gets -1 instead when it continues a suspended listing, with the stream in its cursor
+	void readDirectory(int fd, Listing &listing, size_t limit, const NamePattern &filter);
+	void scanDirectory(int fd, Listing &listing, size_t limit, const NamePattern &filter);
+	// stats entries of unknown type, at the end of listing
+	void resolveUnknown(int fd, Listing &listing);
 
-	void cleanupOpenDescriptors();
 	uintmax_t sizeNative(const Path &path);
-	void resizeNative(const Utility::NativePath &path, uintmax_t size);
+	void resizeNative(const Path &path, uintmax_t size);
 
 	template<typename ExpectedType>
-	std::shared_ptr<ExpectedType> descriptor(const Utility::NativePath &path) {
-		std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
-		assert(path.absolute());
-		cleanupOpenDescriptors();
-
-		std::shared_ptr<ExpectedType> result;
-
-		auto its = openDescriptors.equal_range(path);
-		for(auto it = its.first; it != its.second; ++it) {
-			result = std::dynamic_pointer_cast<ExpectedType>(it->second.lock());
-			if(result) {
-				LOGN1 << "Found existing descriptor";
-				break;
+	std::shared_ptr<ExpectedType> descriptor(const Path &path) {
+		return std::static_pointer_cast<ExpectedType>(acquire(ExpectedType::kind, path,
+			[this, &path]() -> std::shared_ptr<NativeFileDescriptor> {
+				return std::make_shared<ExpectedType>(this, path);
 			}
-		}
-
-		if(!result) {
-			result = std::make_shared<ExpectedType>(
-				std::dynamic_pointer_cast<NativeFSDriver>(shared_from_this()), path
-			);
-			openDescriptors.insert(std::make_pair(path, result));
-		}
-		return result;
+		));
 	}
 
 	class NativeOpenFile: public NativeFileDescriptor, public Driver::OpenFile {
-		void seek(size_t pos);
 	public:
-		explicit NativeOpenFile(const std::shared_ptr<NativeFSDriver> &driver, const Utility::NativePath &nativePath);
+		static const size_t kind = 0;
+
+		explicit NativeOpenFile(NativeFSDriver *driver, const Path &path);
 		virtual ~NativeOpenFile() override;
 		virtual size_t read(size_t pos, void *buffer, size_t bufferSize) override;
 		virtual size_t write(size_t pos, const void *buffer, size_t bufferSize) override;
+		virtual size_t readv(size_t pos, const std::vector<Buffer> &buffers) override;
+		virtual size_t writev(size_t pos, const std::vector<ConstBuffer> &buffers) override;
 		virtual size_t size() override;
+		// posix_fadvise() on Linux, ignored elsewhere
+		virtual void advise(Advice advice, uintmax_t offset, uintmax_t length) override;
+		// fdatasync() where available, fsync() elsewhere
+		virtual void sync() override;
+
+		// ends of mapped ranges lent by view() and still used, file is not shrunk below them
+		std::mutex viewsMutex;
+		std::multiset<uintmax_t> viewEnds;
 
 		friend class NativeFSDriver;
 	};
@@ -91,25 +229,73 @@ class TIALVFS_EXPORT NativeFSDriver: public Driver {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 		void *_ptr = nullptr;
 		uintmax_t _size = 0;
+		// Length of address range reserved with an inaccessible anonymous mapping, file is
+		// mapped over its beginning with MAP_FIXED. Zero if nothing is reserved.
+		size_t _capacity = 0;
 #else
 #error "Platform not supported"
 #endif
+		static const size_t kind = 1;
 
+		// follows file resized to size, within reservation if there is one
+		void remap(size_t size);
 		virtual void descriptorClose() override;
 		virtual void descriptorOpen() override;
-		explicit NativeMappedFile(const std::shared_ptr<NativeFSDriver> &driver, const Utility::NativePath &nativePath);
+		virtual void descriptorReused() override;
+		explicit NativeMappedFile(NativeFSDriver *driver, const Path &path);
 		virtual ~NativeMappedFile() override;
 		virtual void *get() override;
 		virtual size_t size() override;
 		virtual void resize(size_t size) override;
+		virtual size_t capacity() override;
+		virtual void reserve(size_t capacity) override;
+		virtual void advise(Advice advice, size_t offset, size_t length) override;
+		// maps the file again over the same addresses with MAP_POPULATE where available
+		virtual void populate() override;
+		virtual void flush(size_t offset, size_t length, bool async) override;
 
 		friend class NativeFSDriver;
 	};
 
+	// mapping a range costs more than copying up to this many bytes
+	static const size_t viewCopyLimit = 16*1024;
+
+	// Mapped with a margin of one page, so it can be moved over the same addresses
+	class NativeMappedWindow: public Driver::MappedWindow {
+		std::shared_ptr<NativeOpenFile> file;
+		bool writable;
+		bool populate;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+		void *base = nullptr;
+		size_t mapped = 0;
+#else
+#error "Platform not supported"
+#endif
+		uintmax_t _offset = 0;
+		size_t _length;
+
+	public:
+		NativeMappedWindow(const std::shared_ptr<NativeOpenFile> &file, uintmax_t offset, size_t length,
+			bool writable, bool populate);
+		virtual ~NativeMappedWindow() override;
+		virtual void *get() override;
+		virtual uintmax_t offset() override;
+		virtual size_t length() override;
+		virtual size_t size() override;
+		virtual void move(uintmax_t offset) override;
+		virtual void advise(Advice advice) override;
+		virtual void flush(bool async) override;
+	};
+
 public:
 	explicit NativeFSDriver(const Utility::NativePath &nativeDirectory, const std::string &name = std::string());
+	virtual ~NativeFSDriver() override;
     virtual FileEntry get(const Path &path) override;
+	virtual boost::optional<FileEntry> tryGet(const Path &path) override;
     virtual std::vector<FileEntry> listDirectory(const Path &path) override;
+	virtual std::vector<FileEntry> listDirectory(const Path &path, const NamePattern &filter) override;
+	virtual void listDirectory(const Path &path, Listing &listing, size_t limit = 0,
+		const NamePattern &filter = NamePattern()) override;
 	virtual uintmax_t size(const Path &path) override;
 	virtual void resize(const Path &path, uintmax_t size) override;
 	virtual void createFile(const Path &path) override;
@@ -118,6 +304,40 @@ public:
 	virtual void removeDirectory(const Path &path) override;
 	virtual std::shared_ptr<OpenFile> open(const Path &path) override;
 	virtual std::shared_ptr<MappedFile> map(const Path &path) override;
+	// windows share descriptor of the file and are independent of its whole mapping
+	virtual std::shared_ptr<MappedWindow> mapWindow(const Path &path, uintmax_t offset, size_t length,
+		bool writable, bool populate = false) override;
+	// Ranges longer than viewCopyLimit are lent as read-only mappings of their own, shorter ones
+	// are copied. Until a mapped view is gone, resize() refuses to shrink the file below it
+	// with FileViewed; truncation done behind the driver cannot be prevented, reading a view
+	// past the new end of file then raises SIGBUS.
+	virtual ViewedRange view(const Path &path, uintmax_t offset, size_t length) override;
+	// On Linux every request is submitted to io_uring as linked open, read and close of a
+	// direct descriptor, so whole batch takes a few system calls. Needs kernel 5.17 or newer,
+	// otherwise thread pool is used.
+	virtual void readMany(std::vector<ReadRequest> &requests, ThreadPool &pool, size_t queueDepth) override;
+
+	// On Linux reads and writes are submitted to io_uring and no thread waits for them; the file
+	// is still opened on the calling thread, and results are handed to executor, where
+	// continuations run. Without io_uring, and for all other operations, synchronous ones run
+	// on executor.
+	virtual Task<size_t> readAsync(const Path &path, uintmax_t pos, const Buffer &buffer,
+		const std::shared_ptr<Executor> &executor) override;
+	virtual Task<size_t> writeAsync(const Path &path, uintmax_t pos, const ConstBuffer &buffer,
+		const std::shared_ptr<Executor> &executor) override;
+
+	Scanner scanner() const;
+	void setScanner(Scanner scanner);
+
+	// number of directory descriptors kept open, besides the one of the mount root
+	size_t directoryCacheCapacity() const;
+	void setDirectoryCacheCapacity(size_t capacity);
+	DirectoryCacheStatistics directoryCacheStatistics() const;
+
+	// number of file descriptors and mappings kept open while nobody uses them
+	size_t descriptorCacheCapacity() const;
+	void setDescriptorCacheCapacity(size_t capacity);
+	DescriptorCacheStatistics descriptorCacheStatistics() const;
 };
 
 }
@@ -1,11 +1,14 @@
 #pragma once
 #include "TialVFSExport.hpp"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 
 #include <TialUtility/Logger.hpp>
 
+#include "Async.hpp"
 #include "Common.hpp"
 
 namespace Tial {
@@ -25,7 +28,14 @@ public:
 private:
 	std::weak_ptr<Root> _root;
 	std::weak_ptr<Directory> _parent;
-	mutable Validity _valid = Validity::Invalid;
+	const bool _topLevel;
+	// own validity in the lowest bits, generation of the parent it was validated against above
+	mutable std::atomic<uint64_t> _state;
+	// validity derived from the whole parent chain, cached for one epoch of the root
+	mutable std::atomic<uint64_t> _checked;
+
+	bool setState(Validity validity, uintmax_t epoch);
+	std::shared_ptr<Root> treeRoot() const;
 
 protected:
 	std::string _name;
@@ -33,8 +43,10 @@ protected:
 	Object(const std::shared_ptr<Root> &root, const std::shared_ptr<Directory> &parent, const std::string &name);
 	virtual void validate(); // make object Valid
 	void validate() const;
+	uintmax_t validateParent(); // make parent chain Valid, returns parent generation to validate against
 	void checkIfBroken() const;
-	virtual void markValid(); // mark object as Valid
+	void advanceEpoch(bool invalidateLookups); // announce state change to the whole tree
+	virtual void markValid(uintmax_t epoch); // mark object as Valid against given parent generation
 	virtual void markInvalid(); // make object Invalid
 	virtual void markBroken(); // make object Broken
 
@@ -49,9 +61,13 @@ public:
 	virtual std::shared_ptr<Directory> parent() const;
 
 	virtual void remove();
+	// runs remove() on executor of the root
+	Task<void> removeAsync();
 
 	friend class Directory;
+	friend class DirectoryContent;
 	friend class Driver;
+	friend class Glob;
 	friend Utility::Logger::Stream &operator<<(Utility::Logger::Stream &s, const Object &object);
 };
 
@@ -1,23 +1,68 @@
 #pragma once
 #include "TialVFSExport.hpp"
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include "Directory.hpp"
 #include "Driver.hpp"
+#include "LookupCache.hpp"
+#include "ThreadPool.hpp"
 
 namespace Tial {
 namespace VFS {
 
+class File;
+
 class TIALVFS_EXPORT Root: public Directory {
+public:
+	// One read of a batch, fills buffer with content of file starting at offset
+	struct ReadRequest {
+		std::shared_ptr<File> file;
+		uintmax_t offset = 0;
+		Driver::Buffer buffer{nullptr, 0};
+		size_t transferred = 0; // bytes read, less than buffer size at end of file
+		std::exception_ptr error; // set if this request failed
+	};
+
+private:
+	LookupCache _lookupCache;
+	std::atomic<uintmax_t> _epoch{0}; // advanced on every validity change in the tree
+	std::mutex threadPoolMutex;
+	std::shared_ptr<ThreadPool> _threadPool;
+	std::shared_ptr<Executor> poolExecutor;
+	std::shared_ptr<Executor> _executor;
+	size_t _workerCount;
+	std::atomic<size_t> _queueDepth{64};
+
 public:
 	friend class Directory;
+	friend class Object;
 
 	Root();
 
 	virtual Path path() const override;
 	virtual std::shared_ptr<Root> root() override;
 	virtual std::shared_ptr<Directory> parent() const override;
+
+	LookupCache &lookupCache();
+
+	// pool used by parallel traversals, created on first use
+	std::shared_ptr<ThreadPool> threadPool();
+	size_t workerCount();
+	void setWorkerCount(size_t workerCount);
+
+	// runs asynchronous operations of the tree, thread pool of the root unless set
+	std::shared_ptr<Executor> executor();
+	void setExecutor(const std::shared_ptr<Executor> &executor); // null restores the default
+
+	// Reads from many files at once, handing requests to drivers of the files in batches.
+	// Every request gets its own result, failed ones do not stop the rest.
+	void readMany(std::vector<ReadRequest> &requests);
+	// number of requests each driver keeps in progress at a time
+	size_t queueDepth() const;
+	void setQueueDepth(size_t queueDepth);
 };
 
 }
@@ -0,0 +1,78 @@
+#pragma once
+#include "TialVFSExport.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tial {
+namespace VFS {
+
+// Fixed set of worker threads, each with its own deque of tasks. Workers take tasks
+// spawned by themselves from the back of their deque and, when it runs dry, steal
+// the oldest tasks from the front of other deques. Threads waiting for a TaskGroup
+// run queued tasks too, so a pool with no workers still makes progress.
+class TIALVFS_EXPORT ThreadPool {
+public:
+	typedef std::function<void()> Task;
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<size_t> queued{0};
+	std::atomic<size_t> next{0};
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	void run(size_t index);
+	bool pop(size_t index, Task &task);
+	bool steal(size_t index, Task &task);
+
+public:
+	explicit ThreadPool(size_t workers = std::thread::hardware_concurrency());
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+	// finishes all queued tasks before returning
+	~ThreadPool();
+
+	size_t size() const;
+	void submit(Task task);
+	// runs one queued task on calling thread, returns false if there was none
+	bool runPending();
+};
+
+// Tracks completion of related tasks, which may spawn further tasks of the group.
+class TIALVFS_EXPORT TaskGroup {
+	ThreadPool &pool;
+	std::mutex mutex;
+	std::condition_variable done;
+	size_t pending = 0;
+	std::exception_ptr error;
+	std::atomic<bool> _failed{false};
+
+public:
+	explicit TaskGroup(ThreadPool &pool);
+	TaskGroup(const TaskGroup &) = delete;
+	TaskGroup &operator=(const TaskGroup &) = delete;
+	~TaskGroup();
+
+	void run(ThreadPool::Task task);
+	// helps running queued tasks until all tasks of the group finish, rethrows first exception
+	void wait();
+	bool failed() const;
+};
+
+}
+}
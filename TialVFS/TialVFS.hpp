@@ -1,9 +1,15 @@
 #pragma once
+#include "Async.hpp"
 #include "Common.hpp"
 #include "Driver.hpp"
 #include "Exception.hpp"
 #include "File.hpp"
+#include "Glob.hpp"
+#include "GroupCommit.hpp"
+#include "LookupCache.hpp"
 #include "MemoryDriver.hpp"
+#include "NamePattern.hpp"
 #include "NativeFSDriver.hpp"
 #include "Object.hpp"
 #include "Root.hpp"
+#include "ThreadPool.hpp"
@@ -0,0 +1,59 @@
+#include <TialUtility/TialUtility.hpp>
+#include <TialVFS/TialVFS.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Builds a tree of directories with files on native filesystem, then collects it from
+// a freshly mounted root with growing number of workers; listing of sibling directories
+// runs concurrently, so time should drop with worker count up to number of cores.
+
+namespace {
+
+const char *treeName = "CollectTreeBenchmark";
+
+void build(size_t directories, size_t files) {
+	auto root = std::make_shared<Tial::VFS::Root>();
+	root->mount(std::make_shared<Tial::VFS::NativeFSDriver>(Tial::Utility::NativeDirectory::current().path()));
+	auto tree = root->createDirectory(treeName);
+	for(size_t i = 0; i < directories; ++i) {
+		auto directory = tree->createDirectory(std::to_string(i));
+		for(size_t j = 0; j < files; ++j)
+			directory->createFile(std::to_string(j));
+	}
+}
+
+void benchmark(size_t workers, Tial::VFS::Directory::Traversal traversal) {
+	auto root = std::make_shared<Tial::VFS::Root>();
+	root->setWorkerCount(workers);
+	root->mount(std::make_shared<Tial::VFS::NativeFSDriver>(Tial::Utility::NativeDirectory::current().path()));
+	auto tree = root->get<Tial::VFS::Directory>(treeName);
+
+	auto start = std::chrono::steady_clock::now();
+	auto elements = tree->collect(traversal);
+	auto end = std::chrono::steady_clock::now();
+
+	auto total = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+	std::cout << (traversal == Tial::VFS::Directory::Traversal::Parallel ? "parallel, " : "sequential, ")
+			<< workers << " workers: " << elements.size() << " elements in " << total/1000 << " ms" << std::endl;
+}
+
+}
+
+int main() {
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, "Tial::VFS");
+
+	build(1000, 100);
+
+	benchmark(0, Tial::VFS::Directory::Traversal::DepthFirst);
+	for(size_t workers = 1; workers <= 2*std::thread::hardware_concurrency(); workers *= 2)
+		benchmark(workers, Tial::VFS::Directory::Traversal::Parallel);
+
+	auto root = std::make_shared<Tial::VFS::Root>();
+	root->mount(std::make_shared<Tial::VFS::NativeFSDriver>(Tial::Utility::NativeDirectory::current().path()));
+	root->get<Tial::VFS::Directory>(treeName)->remove();
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+#include <TialUtility/TialUtility.hpp>
+#include <TialVFS/TialVFS.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Creates N files in a single directory and reports time per file; with in-place
+// directory cache updates the per-file cost should stay flat as N grows.
+
+namespace {
+
+void benchmark(const std::string &name, const std::shared_ptr<Tial::VFS::Directory> &mountPoint, size_t count) {
+	auto directory = mountPoint->createDirectory("CreateFilesBenchmark");
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < count; ++i)
+		directory->createFile(std::to_string(i));
+	auto end = std::chrono::steady_clock::now();
+
+	auto total = std::chrono::duration_cast<std::chrono::microseconds>(end-start).count();
+	std::cout << name << ": " << count << " files in " << total/1000 << " ms, "
+			<< static_cast<double>(total)/count << " us per file" << std::endl;
+
+	directory->remove();
+}
+
+}
+
+int main() {
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, "Tial::VFS");
+
+	for(size_t count: {1000u, 10000u, 100000u}) {
+		auto root = std::make_shared<Tial::VFS::Root>();
+		root->mount(std::make_shared<Tial::VFS::MemoryDriver>());
+		benchmark("MemoryDriver", root, count);
+	}
+
+	for(size_t count: {1000u, 10000u, 100000u}) {
+		auto root = std::make_shared<Tial::VFS::Root>();
+		root->mount(std::make_shared<Tial::VFS::NativeFSDriver>(Tial::Utility::NativeDirectory::current().path()));
+		benchmark("NativeFSDriver", root, count);
+	}
+
+	return 0;
+}
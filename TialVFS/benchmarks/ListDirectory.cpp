@@ -0,0 +1,59 @@
+#include <TialUtility/TialUtility.hpp>
+#include <TialVFS/TialVFS.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Lists a single directory with N files using readdir and getdents64 scanners of
+// NativeFSDriver; batched reading should cut time per entry, most visibly for large N.
+
+namespace {
+
+const char *directoryName = "ListDirectoryBenchmark";
+const size_t repetitions = 5;
+
+void benchmark(const std::shared_ptr<Tial::VFS::NativeFSDriver> &driver, Tial::VFS::NativeFSDriver::Scanner scanner,
+		size_t count) {
+	driver->setScanner(scanner);
+	Tial::VFS::Driver::Listing listing;
+	listing.reserve(count, count*8);
+
+	// first pass warms up the dentry cache
+	driver->listDirectory(Tial::VFS::Path("/")/directoryName, listing);
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < repetitions; ++i) {
+		listing.rewind();
+		driver->listDirectory(Tial::VFS::Path("/")/directoryName, listing);
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	auto total = std::chrono::duration_cast<std::chrono::nanoseconds>(end-start).count()/repetitions;
+	std::cout << (scanner == Tial::VFS::NativeFSDriver::Scanner::GetDents ? "getdents64" : "readdir") << ", "
+			<< listing.size() << " entries: " << total/1000000 << " ms, "
+			<< static_cast<double>(total)/count << " ns per entry" << std::endl;
+}
+
+}
+
+int main() {
+	Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, "Tial::VFS");
+
+	for(size_t count: {1000u, 100000u, 1000000u}) {
+		auto driver = std::make_shared<Tial::VFS::NativeFSDriver>(Tial::Utility::NativeDirectory::current().path());
+		auto directory = Tial::VFS::Path("/")/directoryName;
+		driver->createDirectory(directory);
+		for(size_t i = 0; i < count; ++i)
+			driver->createFile(directory/std::to_string(i));
+
+		benchmark(driver, Tial::VFS::NativeFSDriver::Scanner::ReadDir, count);
+		benchmark(driver, Tial::VFS::NativeFSDriver::Scanner::GetDents, count);
+
+		for(size_t i = 0; i < count; ++i)
+			driver->removeFile(directory/std::to_string(i));
+		driver->removeDirectory(directory);
+	}
+
+	return 0;
+}
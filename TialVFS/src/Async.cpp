@@ -0,0 +1,10 @@
+#include "Async.hpp"
+#include "ThreadPool.hpp"
+
+Tial::VFS::Executor::~Executor() {}
+
+Tial::VFS::ThreadPoolExecutor::ThreadPoolExecutor(const std::shared_ptr<ThreadPool> &pool): pool(pool) {}
+
+void Tial::VFS::ThreadPoolExecutor::execute(std::function<void()> task) {
+	pool->submit(std::move(task));
+}
@@ -2,22 +2,42 @@
 
 #include <queue>
 
-#include <boost/algorithm/string.hpp>
-
 #include "Exception.hpp"
+#include "Glob.hpp"
 #include "Root.hpp"
 
 #define TIAL_MODULE "Tial::VFS::Directory"
 
-size_t Tial::VFS::BasenameHash::operator()(const std::string &x) const {
-	return std::hash<std::string>::operator()(boost::algorithm::to_lower_copy(x));
+Tial::VFS::Directory::Iteration::Iteration(Directory &directory): directory(directory) {
+	std::unique_lock<std::recursive_mutex> lock(directory.mutex);
+	++directory.iterations;
+}
+
+Tial::VFS::Directory::Iteration::~Iteration() {
+	std::unique_lock<std::recursive_mutex> lock(directory.mutex);
+	if(--directory.iterations == 0 && directory.pendingContent) {
+		LOGN3 << "Applying changes made while iterating " << directory.path();
+		directory._content = std::move(*directory.pendingContent);
+		directory.pendingContent.reset();
+	}
 }
 
-bool Tial::VFS::BasenameCompare::operator()(const std::string &x, const std::string &y) const {
-	LOGN3 << "Comparing " << x << " with " << y;
-	bool result = boost::iequals(x, y);
-	LOGN3 << "Result = " << result;
-	return result;
+const Tial::VFS::DirectoryContent &Tial::VFS::Directory::Iteration::content() const {
+	return directory._content;
+}
+
+const Tial::VFS::DirectoryContent &Tial::VFS::Directory::currentContent() const {
+	return pendingContent ? *pendingContent : _content;
+}
+
+Tial::VFS::DirectoryContent &Tial::VFS::Directory::modifiableContent() {
+	if(iterations == 0)
+		return _content;
+	if(!pendingContent) {
+		LOGN3 << "Deferring changes of " << path() << " until its iterations end";
+		pendingContent.reset(new DirectoryContent(_content));
+	}
+	return *pendingContent;
 }
 
 void Tial::VFS::Directory::validate() {
@@ -27,79 +47,110 @@ void Tial::VFS::Directory::validate() {
 		return;
 
 	checkIfBroken();
+	auto epoch = validateParent();
 
 	LOGN1 << "*this = " << *this;
 
 	std::unique_lock<std::recursive_mutex> lock(mutex);
+	if(valid() == Validity::Valid)
+		return;
 	auto d = driver();
 
 	LOGN2 << "Populating " << path() << " using driver " << d.second
 			<< " with relative path " << d.first;
 
-	auto entries = d.second->listDirectory(d.first);
-	for(const auto &entry: entries) {
-		LOGN3 << "entry = " << entry.fileName;
-		auto existing = _content.find(entry.fileName);
-		if(existing != _content.end()) {
-			if(entryMatchesObject(entry, existing->second)) {
-				LOGN3 << "Element " << entry.fileName << " already exists and is correct, skipping";
-				continue;
+	Driver::Listing listing;
+	d.second->listDirectory(d.first, listing);
+
+	// Single hash join of the listing against cached content: objects that are still
+	// correct are moved to the new table, whatever is left in the old one is gone.
+	Reconciliation reconciliation;
+	DirectoryContent content;
+	// files listed with complete attributes do not need to be asked about again
+	std::vector<std::pair<std::shared_ptr<File>, size_t>> described;
+	content.setCaseSensitive(caseSensitive());
+	content.reserve(listing.size());
+	auto &cached = modifiableContent();
+	cached.setCaseSensitive(content.caseSensitive());
+
+	for(size_t i = 0; i < listing.size(); ++i) {
+		const char *name = listing.nameData(i);
+		size_t size = listing.nameSize(i);
+		LOGN3 << "entry = " << name;
+		std::shared_ptr<Object> object;
+		if(auto existing = cached.find(name, size)) {
+			if(objectMatches(*existing, name, size, listing.directory(i))) {
+				LOGN3 << "Element " << name << " already exists and is correct, keeping";
+				object = cached.erase((*existing)->_name);
+				++reconciliation.kept;
 			}
-			LOGN3 << "Element " << entry.fileName << " already exists but differs, removing";
-			existing->second->markBroken();
-			_content.erase(existing);
 		}
-		LOGN3 << "Element " << entry.fileName << " is emplaced";
-		_content.emplace(entry.fileName, entryToObject(entry));
+		if(!object) {
+			LOGN3 << "Element " << name << " is emplaced";
+			object = entryToObject(std::string(name, size), listing.directory(i));
+			++reconciliation.added;
+		}
+		if(!content.insert(object)) {
+			LOGN3 << "Element " << name << " is listed twice, replacing";
+			content.erase(object->_name)->markBroken();
+			content.insert(object);
+			++reconciliation.removed;
+		}
+		if(!listing.directory(i) && listing.attributes(i).complete())
+			described.emplace_back(std::static_pointer_cast<File>(object), i);
 	}
 
-	for(auto element = _content.begin(); element != _content.end();) {
-		for(const auto &entry: entries)
-			if(entry.fileName == element->second->_name) {
-				++element;
-				goto elementLoopEnd;
-			}
-
-		element->second->markBroken();
-		element = _content.erase(element);
-
-elementLoopEnd:;
+	for(const auto &element: cached) {
+		LOGN3 << "Element " << element->_name << " no longer exists, removing";
+		element->markBroken();
+		++reconciliation.removed;
 	}
 
-	markValid();
+	cached = std::move(content);
+	_reconciliation = reconciliation;
+	if(reconciliation.added > 0)
+		invalidateNegativeLookups();
+	LOGN1 << "Reconciled " << path() << ": " << reconciliation.added << " added, "
+			<< reconciliation.removed << " removed, " << reconciliation.kept << " kept";
+
+	// whatever was validated below this directory has to be checked again
+	++_generation;
+	for(const auto &file: described) {
+		file.first->setAttributes(listing.attributes(file.second));
+		file.first->setState(Validity::Valid, _generation);
+	}
+	markValid(epoch);
 }
 
 void Tial::VFS::Directory::markInvalid() {
+	// descendants notice changed generation lazily, when they are used again
+	++_generation;
 	Object::markInvalid();
-
-	for(auto &element: _content)
-		element.second->markInvalid();
 }
 
 void Tial::VFS::Directory::markBroken() {
+	// descendants notice broken parent lazily, when they are used again
 	Object::markBroken();
-
-	for(auto &element: _content)
-		element.second->markBroken();
 }
 
-bool Tial::VFS::Directory::entryMatchesObject(const Driver::FileEntry &entry, const std::shared_ptr<Object> &object) {
-	if(entry.fileName != object->_name)
+bool Tial::VFS::Directory::objectMatches(const std::shared_ptr<Object> &object, const char *name, size_t size,
+		bool directory) {
+	if(object->_name.size() != size || object->_name.compare(0, size, name, size) != 0)
 		return false;
 
-	if(entry.directory != static_cast<bool>(std::dynamic_pointer_cast<Directory>(object)))
+	if(directory != (dynamic_cast<const Directory*>(object.get()) != nullptr))
 		return false;
 
 	return true;
 }
 
-std::shared_ptr<Tial::VFS::Object> Tial::VFS::Directory::entryToObject(const Driver::FileEntry &entry) {
-	LOGN3 << "parent = " << *this << ", entry.fileName = " << entry.fileName;
+std::shared_ptr<Tial::VFS::Object> Tial::VFS::Directory::entryToObject(const std::string &name, bool directory) {
+	LOGN3 << "parent = " << *this << ", name = " << name;
 	auto p = std::dynamic_pointer_cast<Directory>(shared_from_this());
-	if(!entry.directory)
-		return std::shared_ptr<Object>(new File(root(), p, entry.fileName));
+	if(!directory)
+		return std::shared_ptr<Object>(new File(root(), p, name));
 	else
-		return std::shared_ptr<Object>(new Directory(root(), p, entry.fileName));
+		return std::shared_ptr<Object>(new Directory(root(), p, name));
 }
 
 std::pair<Tial::VFS::Path, std::shared_ptr<Tial::VFS::Driver>> Tial::VFS::Directory::driver() const {
@@ -118,46 +169,95 @@ std::pair<Tial::VFS::Path, std::shared_ptr<Tial::VFS::Driver>> Tial::VFS::Direct
 	return std::make_pair(Path("/")/path, driver);
 }
 
-std::shared_ptr<Tial::VFS::Object> Tial::VFS::Directory::get(const Path &path) {
-	validate();
-
-	LOGN2 << "path = " << path;
-	if(std::string(path).find("*") != std::string::npos) {
-		auto all = getAll(path);
-		if(all.empty())
-			THROW Exceptions::ElementNotFound(path, this->path());
-		return all[0];
+bool Tial::VFS::Directory::caseSensitive() const {
+	auto elem = std::dynamic_pointer_cast<const Directory>(shared_from_this());
+	while(!elem->_driver) {
+		elem = elem->parent();
+		if(!elem)
+			THROW Exception("No parent set");
 	}
+	return elem->_caseSensitive;
+}
 
+std::shared_ptr<Tial::VFS::Object> Tial::VFS::Directory::resolve(const Path &path, bool required) {
 	assert(!path.empty());
-	if(path.size() == 1) {
-		try {
-			for(auto i: _content)
-				LOGN3 << "_content = " << i;
-			auto child = _content.at(path[0]);
-			assert(child);
+	auto directory = std::dynamic_pointer_cast<Directory>(shared_from_this());
+	for(size_t i = 0;; ++i) {
+		directory->validate();
+
+		std::shared_ptr<Object> child;
+		{
+			std::unique_lock<std::recursive_mutex> lock(directory->mutex);
+			if(auto found = directory->currentContent().find(path[i]))
+				child = *found;
+		}
+		if(!child) {
+			LOGN3 << "Element " << path.subpath(i) << " not found in " << directory->path();
+			if(required)
+				THROW Exceptions::ElementNotFound(path.subpath(i), directory->path());
+			return nullptr;
+		}
+
+		if(i+1 == path.size()) {
 			LOGN3 << "Returning child of type " << Utility::typeId(*child);
 			return child;
-		} catch(const std::out_of_range &e) {
-			THROW Exceptions::ElementNotFound(path, this->path());
+		}
+
+		directory = std::dynamic_pointer_cast<Directory>(child);
+		if(!directory) {
+			LOGN3 << "Element " << child->path() << " is not a directory";
+			if(required)
+				THROW Exceptions::ElementKindInvalid(child->path(), "expected directory");
+			return nullptr;
 		}
 	}
-	auto head = get<Directory>(path[0]);
-	assert(head);
-	auto child = head->get(path.subpath(1));
-	assert(child);
-	LOGN3 << "Returning child of type " << Utility::typeId(*child);
+}
+
+std::shared_ptr<Tial::VFS::Object> Tial::VFS::Directory::lookup(const Path &path) {
+	LOGN2 << "path = " << path;
+	std::string key(path);
+	if(key.find("*") != std::string::npos)
+		return Glob(path).first(std::dynamic_pointer_cast<Directory>(shared_from_this()));
+
+	auto r = root();
+	if(!r)
+		return resolve(path);
+
+	auto &cache = r->lookupCache();
+	std::shared_ptr<Object> cached;
+	if(cache.find(*this, key, cached)) {
+		LOGN3 << "Returning cached " << (cached ? "child" : "miss");
+		return cached;
+	}
+
+	auto stamp = cache.stamp();
+	auto child = resolve(path);
+	cache.insert(shared_from_this(), key, child, stamp);
 	return child;
 }
 
+std::shared_ptr<Tial::VFS::Object> Tial::VFS::Directory::get(const Path &path) {
+	if(auto object = lookup(path))
+		return object;
+	// misses are cached without their reason, resolving again reports it
+	if(std::string(path).find("*") == std::string::npos)
+		return resolve(path, true);
+	THROW Exceptions::ElementNotFound(path, this->path());
+}
+
+bool Tial::VFS::Directory::exists(const Path &path) {
+	return static_cast<bool>(lookup(path));
+}
+
 Tial::VFS::Directory::Directory(const std::shared_ptr<Root> &root, const std::shared_ptr<Directory> &directory,
 	const std::string &name): Object(root, directory, name) {}
 
-void Tial::VFS::Directory::mount(const std::shared_ptr<Driver> &driver) {
+void Tial::VFS::Directory::mount(const std::shared_ptr<Driver> &driver, bool caseSensitive) {
 	LOGI << "Mounting driver " << driver << " on " << path();
 	if(_driver)
 		THROW Exceptions::AlreadyMounted(path());
 	_driver = driver;
+	_caseSensitive = caseSensitive;
 	_driver->registerMountPoint(std::dynamic_pointer_cast<Directory>(shared_from_this()));
 	markInvalid();
 }
@@ -173,89 +273,231 @@ void Tial::VFS::Directory::unmount() {
 
 	markInvalid();
 
-	for(auto &element: _content)
-		element.second->markBroken();
-	_content.clear();
+	std::unique_lock<std::recursive_mutex> lock(mutex);
+	auto &cached = modifiableContent();
+	for(const auto &element: cached)
+		element->markBroken();
+	cached.clear();
 }
 
 std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Directory::content() {
 	LOGN2 << "*this = " << *this;
 	validate();
 
+	std::unique_lock<std::recursive_mutex> lock(mutex);
+	const auto &cached = currentContent();
 	std::vector<std::shared_ptr<Tial::VFS::Object>> v;
-	for(auto i: _content)
-		v.push_back(i.second);
+	v.reserve(cached.size());
+	for(const auto &i: cached)
+		v.push_back(i);
 	return v;
 //	return content(std::dynamic_pointer_cast<Directory>(shared_from_this()), "");
 }
 
-std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Directory::collect() {
-	LOGN1 << "Collecting all subelements of " << *this;
+std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Directory::content(const NamePattern &filter) {
+	LOGN2 << "*this = " << *this << ", filter = " << filter.text();
+
 	std::vector<std::shared_ptr<Tial::VFS::Object>> v;
-	for(auto i: content()) {
-		v.push_back(i);
-		if(auto dir = std::dynamic_pointer_cast<Directory>(i)) {
-			auto collection = dir->collect();
-			v.insert(v.end(), collection.begin(), collection.end());
+	auto cached = [this, &filter, &v]() {
+		const auto &content = currentContent();
+		for(const auto &element: content)
+			if(filter.matches(element->_name, content.caseSensitive()))
+				v.push_back(element);
+	};
+
+	if(valid() == Validity::Valid) {
+		std::unique_lock<std::recursive_mutex> lock(mutex);
+		cached();
+		return v;
+	}
+
+	checkIfBroken();
+	validateParent();
+
+	std::unique_lock<std::recursive_mutex> lock(mutex);
+	if(valid() == Validity::Valid) {
+		cached();
+		return v;
+	}
+
+	auto d = driver();
+	NamePattern nativeFilter = filter;
+	nativeFilter.setCaseSensitive(caseSensitive());
+	auto &content = modifiableContent();
+	content.setCaseSensitive(nativeFilter.caseSensitive());
+
+	// listed entries are merged into cached content the same way full reconciliation does,
+	// so objects returned now are kept once the whole directory gets listed
+	Driver::Listing listing;
+	d.second->listDirectory(d.first, listing, 0, nativeFilter);
+	v.reserve(listing.size());
+	for(size_t i = 0; i < listing.size(); ++i) {
+		const char *name = listing.nameData(i);
+		size_t size = listing.nameSize(i);
+		std::shared_ptr<Object> object;
+		if(auto existing = content.find(name, size)) {
+			if(objectMatches(*existing, name, size, listing.directory(i)))
+				object = *existing;
+			else
+				content.erase((*existing)->_name)->markBroken();
+		}
+		if(!object) {
+			object = entryToObject(std::string(name, size), listing.directory(i));
+			content.insert(object);
 		}
+		v.push_back(object);
 	}
+	LOGN2 << "Partially populated " << path() << " with " << v.size() << " elements";
 	return v;
 }
 
-std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Directory::getAll(const Path &path) {
-	LOGN1 << "Getting all subelements of " << this->path() << " with path " << path;
+Tial::VFS::Directory::Reconciliation Tial::VFS::Directory::reconciliation() {
+	std::unique_lock<std::recursive_mutex> lock(mutex);
+	return _reconciliation;
+}
 
+std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Directory::collect(Traversal traversal) {
+	LOGN1 << "Collecting all subelements of " << *this;
 	std::vector<std::shared_ptr<Tial::VFS::Object>> v;
+	std::mutex vMutex;
+	walk([&](const std::shared_ptr<Object> &object) {
+		std::unique_lock<std::mutex> lock(vMutex);
+		v.push_back(object);
+		return Visit::Continue;
+	}, traversal);
+	return v;
+}
+
+bool Tial::VFS::Directory::forEachChild(const std::function<bool(const std::shared_ptr<Object> &)> &function) {
+	LOGN2 << "*this = " << *this;
 
-	std::unordered_map<Path, std::shared_ptr<Tial::VFS::Object>> map;
-	// left part of pattern => directory in which it should match
-	std::queue<std::pair<Path, std::shared_ptr<Directory>>> pending;
+	validate();
+	// validating a child may list this directory again on the same thread
+	Iteration iteration(*this);
+	for(const auto &element: iteration.content())
+		if(!function(element))
+			return false;
+	return true;
+}
+
+bool Tial::VFS::Directory::walk(const std::function<Visit(const std::shared_ptr<Object> &)> &function,
+		Traversal traversal) {
+	LOGN1 << "Walking " << *this << " (traversal = " << static_cast<int>(traversal) << ")";
+	switch(traversal) {
+	case Traversal::DepthFirst:
+		return walkDepthFirst(function);
+	case Traversal::BreadthFirst:
+		return walkBreadthFirst(function);
+	case Traversal::Parallel:
+		return walkParallel(function);
+	}
+	THROW std::logic_error("Unknown traversal");
+}
+
+bool Tial::VFS::Directory::walkDepthFirst(const std::function<Visit(const std::shared_ptr<Object> &)> &function) {
+	validate();
+	Iteration iteration(*this);
+	for(const auto &element: iteration.content()) {
+		auto visit = function(element);
+		if(visit == Visit::Stop)
+			return false;
+		if(visit == Visit::Skip)
+			continue;
+		if(auto directory = dynamic_cast<Directory*>(element.get()))
+			if(!directory->walkDepthFirst(function))
+				return false;
+	}
+	return true;
+}
 
-	pending.push(std::make_pair(
-		path, std::dynamic_pointer_cast<Directory>(shared_from_this())
-	));
+bool Tial::VFS::Directory::walkBreadthFirst(const std::function<Visit(const std::shared_ptr<Object> &)> &function) {
+	// only directories are queued, files are visited in place
+	std::queue<std::shared_ptr<Directory>> pending;
+	pending.push(std::dynamic_pointer_cast<Directory>(shared_from_this()));
 
 	while(!pending.empty()) {
-		auto element = pending.front();
+		auto directory = std::move(pending.front());
 		pending.pop();
 
-		if(element.first.empty()) {
-			LOGN1 << "Empty pattern, adding " << element.second << " and exiting";
-			map.emplace(element.second->path(), element.second);
-			continue;
-		}
+		bool completed = directory->forEachChild([&](const std::shared_ptr<Object> &element) {
+			auto visit = function(element);
+			if(visit == Visit::Stop)
+				return false;
+			if(visit == Visit::Continue)
+				if(auto child = std::dynamic_pointer_cast<Directory>(element))
+					pending.push(std::move(child));
+			return true;
+		});
+		if(!completed)
+			return false;
+	}
+	return true;
+}
 
-		LOGN2 << "Processing element " << element;
-		auto pattern = element.first[0];
-		if(pattern == "**") {
-			// collect ALL subdirectories recursively
-			for(auto entry: element.second->collect())
-				if(auto dir = std::dynamic_pointer_cast<Directory>(entry)) {
-					LOGN3 << "Found entry " << dir;
-					pending.push(std::make_pair(element.first.subpath(1), dir));
-				} else if(element.first.size() == 1) {
-					v.push_back(entry);
-				}
-		} else {
-			auto content = element.second->content();
-			LOGN2 << "Received " << content.size() << " elements";
-			for(auto entry: content) {
-				LOGN3 << "Processing entry " << entry->name();
-				if(Utility::Wildcards::match(pattern, entry->name())) {
-					LOGN3 << "Found matching entry " << entry << " (to"
-							<< pattern << ", pattern left " << element.first.size() << ")";
-					if(element.first.size() == 1)
-						map.emplace(entry->path(), entry);
-					if(auto dir = std::dynamic_pointer_cast<Directory>(entry))
-						pending.push(std::make_pair(element.first.subpath(1), dir));
-				}
+bool Tial::VFS::Directory::walkParallel(const std::function<Visit(const std::shared_ptr<Object> &)> &function) {
+	auto r = root();
+	if(!r)
+		return walkDepthFirst(function);
+	auto pool = r->threadPool();
+
+	// every directory is listed and visited by separate task, spawned by its parent; group
+	// is declared last, so that it waits for the tasks before what they use is destroyed
+	std::atomic<bool> stopped{false};
+	std::function<void(const std::shared_ptr<Directory> &)> visit;
+	TaskGroup group(*pool);
+	visit = [&](const std::shared_ptr<Directory> &directory) {
+		if(stopped)
+			return;
+		directory->forEachChild([&](const std::shared_ptr<Object> &element) {
+			if(stopped)
+				return false;
+			auto action = function(element);
+			if(action == Visit::Stop) {
+				stopped = true;
+				return false;
 			}
-		}
+			if(action == Visit::Continue)
+				if(auto child = std::dynamic_pointer_cast<Directory>(element))
+					group.run([&visit, child]() {
+						visit(child);
+					});
+			return true;
+		});
+	};
+
+	visit(std::dynamic_pointer_cast<Directory>(shared_from_this()));
+	group.wait();
+	return !stopped;
+}
+
+std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Directory::getAll(const Path &path, Traversal traversal) {
+	LOGN1 << "Getting all subelements of " << this->path() << " with path " << path;
+	return Glob(path).match(std::dynamic_pointer_cast<Directory>(shared_from_this()), 0, traversal);
+}
+
+void Tial::VFS::Directory::invalidateNegativeLookups() {
+	if(auto r = root())
+		r->lookupCache().invalidateNegative();
+}
+
+void Tial::VFS::Directory::insertCreated(const std::shared_ptr<Object> &object) {
+	invalidateNegativeLookups();
+	std::unique_lock<std::recursive_mutex> lock(mutex);
+	auto &content = modifiableContent();
+	if(!content.insert(object)) {
+		// name differs only in case from an entry that is already cached
+		LOGN3 << "Element " << object->_name << " replaces cached entry";
+		content.erase(object->_name)->markBroken();
+		content.insert(object);
 	}
+}
 
-	for(auto i: map)
-		v.push_back(i.second);
-	return v;
+void Tial::VFS::Directory::eraseRemoved(const Object &object) {
+	std::unique_lock<std::recursive_mutex> lock(mutex);
+	auto &content = modifiableContent();
+	auto existing = content.find(object._name);
+	if(existing && existing->get() == &object)
+		content.erase(object._name);
 }
 
 std::shared_ptr<Tial::VFS::File> Tial::VFS::Directory::createFile(const std::string &name) {
@@ -265,8 +507,9 @@ std::shared_ptr<Tial::VFS::File> Tial::VFS::Directory::createFile(const std::str
 	auto d = driver();
 	d.second->createFile(d.first/name);
 
-	markInvalid();
-	return get<File>(name);
+	auto file = std::dynamic_pointer_cast<File>(entryToObject(name, false));
+	insertCreated(file);
+	return file;
 }
 
 std::shared_ptr<Tial::VFS::Directory> Tial::VFS::Directory::createDirectory(const std::string &name) {
@@ -276,9 +519,30 @@ std::shared_ptr<Tial::VFS::Directory> Tial::VFS::Directory::createDirectory(cons
 	auto d = driver();
 	d.second->createDirectory(d.first/name);
 
-	markInvalid();
-	return get<Directory>(name);
-	//return createDirectory(std::dynamic_pointer_cast<Directory>(shared_from_this()), name);
+	auto directory = std::dynamic_pointer_cast<Directory>(entryToObject(name, true));
+	insertCreated(directory);
+	return directory;
+}
+
+Tial::VFS::Task<std::vector<std::shared_ptr<Tial::VFS::Object>>> Tial::VFS::Directory::contentAsync() {
+	auto self = std::dynamic_pointer_cast<Directory>(shared_from_this());
+	return async(*root()->executor(), [self]() {
+		return self->content();
+	});
+}
+
+Tial::VFS::Task<std::shared_ptr<Tial::VFS::File>> Tial::VFS::Directory::createFileAsync(const std::string &name) {
+	auto self = std::dynamic_pointer_cast<Directory>(shared_from_this());
+	return async(*root()->executor(), [self, name]() {
+		return self->createFile(name);
+	});
+}
+
+Tial::VFS::Task<std::shared_ptr<Tial::VFS::Directory>> Tial::VFS::Directory::createDirectoryAsync(const std::string &name) {
+	auto self = std::dynamic_pointer_cast<Directory>(shared_from_this());
+	return async(*root()->executor(), [self, name]() {
+		return self->createDirectory(name);
+	});
 }
 
 void Tial::VFS::Directory::remove() {
@@ -295,6 +559,6 @@ void Tial::VFS::Directory::remove() {
 		d.second->removeDirectory(d.first);
 	}
 
-	parent()->markInvalid();
+	parent()->eraseRemoved(*this);
 	markBroken();
 }
@@ -0,0 +1,319 @@
+#include "DirectoryContent.hpp"
+#include "Object.hpp"
+
+#include <cstring>
+
+#include <TialUtility/TialUtility.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TIAL_VFS_SSE2 1
+#endif
+
+#define TIAL_MODULE "Tial::VFS::DirectoryContent"
+
+namespace {
+
+// Lowercase ASCII letters of a 16 byte block, leaving every other byte untouched
+inline void foldBlock(const char *input, char *output) {
+#ifdef TIAL_VFS_SSE2
+	__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+	// signed comparison keeps bytes >= 0x80 out of the range
+	__m128i upper = _mm_and_si128(
+		_mm_cmpgt_epi8(value, _mm_set1_epi8('A'-1)),
+		_mm_cmplt_epi8(value, _mm_set1_epi8('Z'+1))
+	);
+	value = _mm_or_si128(value, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(output), value);
+#else
+	for(size_t i = 0; i < 16; ++i) {
+		char c = input[i];
+		output[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+	}
+#endif
+}
+
+inline bool equalFoldedBlock(const char *first, const char *second) {
+	char a[16], b[16];
+	foldBlock(first, a);
+	foldBlock(second, b);
+#ifdef TIAL_VFS_SSE2
+	__m128i equal = _mm_cmpeq_epi8(
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(b))
+	);
+	return _mm_movemask_epi8(equal) == 0xFFFF;
+#else
+	return std::memcmp(a, b, 16) == 0;
+#endif
+}
+
+inline uint64_t rotate(uint64_t value, int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t mixBlock(uint64_t hash, const char *block) {
+	uint64_t first, second;
+	std::memcpy(&first, block, sizeof(first));
+	std::memcpy(&second, block+sizeof(first), sizeof(second));
+	hash = rotate((hash ^ first) * 0x87c37b91114253d5ULL, 31);
+	hash = rotate((hash ^ second) * 0x4cf5ad432745937fULL, 29);
+	return hash;
+}
+
+inline uint64_t finalize(uint64_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+}
+
+uint64_t Tial::VFS::DirectoryContent::hash(const std::string &name, bool caseSensitive) {
+	return hash(name.data(), name.size(), caseSensitive);
+}
+
+uint64_t Tial::VFS::DirectoryContent::hash(const char *data, size_t size, bool caseSensitive) {
+	uint64_t hash = 0x9e3779b97f4a7c15ULL ^ size;
+
+	char block[16];
+	for(; size >= 16; data += 16, size -= 16) {
+		if(caseSensitive)
+			hash = mixBlock(hash, data);
+		else {
+			foldBlock(data, block);
+			hash = mixBlock(hash, block);
+		}
+	}
+
+	if(size > 0) {
+		char tail[16] = {};
+		std::memcpy(tail, data, size);
+		if(caseSensitive)
+			hash = mixBlock(hash, tail);
+		else {
+			foldBlock(tail, block);
+			hash = mixBlock(hash, block);
+		}
+	}
+
+	return finalize(hash);
+}
+
+bool Tial::VFS::DirectoryContent::equal(const std::string &first, const std::string &second, bool caseSensitive) {
+	if(first.size() != second.size())
+		return false;
+	return equal(first.data(), second.data(), first.size(), caseSensitive);
+}
+
+bool Tial::VFS::DirectoryContent::equal(const char *a, const char *b, size_t size, bool caseSensitive) {
+	if(caseSensitive)
+		return std::memcmp(a, b, size) == 0;
+
+	for(; size >= 16; a += 16, b += 16, size -= 16)
+		if(!equalFoldedBlock(a, b))
+			return false;
+
+	if(size > 0) {
+		char tailA[16] = {}, tailB[16] = {};
+		std::memcpy(tailA, a, size);
+		std::memcpy(tailB, b, size);
+		return equalFoldedBlock(tailA, tailB);
+	}
+	return true;
+}
+
+Tial::VFS::DirectoryContent::const_iterator::const_iterator(const Slot *slot, const Slot *end)
+		: slot(slot), end(end) {
+	skipEmpty();
+}
+
+void Tial::VFS::DirectoryContent::const_iterator::skipEmpty() {
+	while(slot != end && !slot->object)
+		++slot;
+}
+
+const std::shared_ptr<Tial::VFS::Object> &Tial::VFS::DirectoryContent::const_iterator::operator*() const {
+	return slot->object;
+}
+
+const std::shared_ptr<Tial::VFS::Object> *Tial::VFS::DirectoryContent::const_iterator::operator->() const {
+	return &slot->object;
+}
+
+Tial::VFS::DirectoryContent::const_iterator &Tial::VFS::DirectoryContent::const_iterator::operator++() {
+	++slot;
+	skipEmpty();
+	return *this;
+}
+
+bool Tial::VFS::DirectoryContent::const_iterator::operator==(const const_iterator &other) const {
+	return slot == other.slot;
+}
+
+bool Tial::VFS::DirectoryContent::const_iterator::operator!=(const const_iterator &other) const {
+	return slot != other.slot;
+}
+
+bool Tial::VFS::DirectoryContent::caseSensitive() const {
+	return _caseSensitive;
+}
+
+void Tial::VFS::DirectoryContent::setCaseSensitive(bool caseSensitive) {
+	if(caseSensitive == _caseSensitive)
+		return;
+
+	LOGN2 << "Switching to case " << (caseSensitive ? "sensitive" : "insensitive") << " mode";
+	_caseSensitive = caseSensitive;
+	for(auto &slot: slots)
+		if(slot.object)
+			slot.hash = hash(slot.object->_name, _caseSensitive);
+	if(hashed)
+		rehash(slots.size());
+}
+
+size_t Tial::VFS::DirectoryContent::size() const {
+	return _size;
+}
+
+bool Tial::VFS::DirectoryContent::empty() const {
+	return _size == 0;
+}
+
+bool Tial::VFS::DirectoryContent::slotMatches(const Slot &slot, const char *name, size_t size, uint64_t hash) const {
+	const auto &other = slot.object->_name;
+	return slot.hash == hash && other.size() == size && equal(other.data(), name, size, _caseSensitive);
+}
+
+size_t Tial::VFS::DirectoryContent::findSlot(const char *name, size_t size, uint64_t hash) const {
+	if(!hashed) {
+		for(size_t i = 0; i < slots.size(); ++i)
+			if(slotMatches(slots[i], name, size, hash))
+				return i;
+		return slots.size();
+	}
+
+	size_t mask = slots.size()-1;
+	for(size_t i = hash & mask;; i = (i+1) & mask) {
+		const auto &slot = slots[i];
+		if(!slot.object)
+			return slots.size();
+		if(slotMatches(slot, name, size, hash))
+			return i;
+	}
+}
+
+const std::shared_ptr<Tial::VFS::Object> *Tial::VFS::DirectoryContent::find(const std::string &name) const {
+	return find(name.data(), name.size());
+}
+
+const std::shared_ptr<Tial::VFS::Object> *Tial::VFS::DirectoryContent::find(const char *name, size_t size) const {
+	if(_size == 0)
+		return nullptr;
+	size_t i = findSlot(name, size, hash(name, size, _caseSensitive));
+	if(i == slots.size())
+		return nullptr;
+	return &slots[i].object;
+}
+
+void Tial::VFS::DirectoryContent::insertHashed(Slot &&slot) {
+	size_t mask = slots.size()-1;
+	size_t i = slot.hash & mask;
+	while(slots[i].object)
+		i = (i+1) & mask;
+	slots[i] = std::move(slot);
+}
+
+void Tial::VFS::DirectoryContent::rehash(size_t capacity) {
+	LOGN3 << "Rehashing " << _size << " entries into " << capacity << " slots";
+	std::vector<Slot> old(capacity);
+	old.swap(slots);
+	hashed = true;
+	for(auto &slot: old)
+		if(slot.object)
+			insertHashed(std::move(slot));
+}
+
+bool Tial::VFS::DirectoryContent::insert(const std::shared_ptr<Object> &object) {
+	assert(object);
+	Slot slot;
+	slot.hash = hash(object->_name, _caseSensitive);
+	if(_size > 0 && findSlot(object->_name.data(), object->_name.size(), slot.hash) != slots.size())
+		return false;
+	slot.object = object;
+
+	if(!hashed && _size < smallCapacity) {
+		slots.push_back(std::move(slot));
+	} else {
+		// keep load factor below 3/4
+		if(!hashed || (_size+1)*4 > slots.size()*3) {
+			size_t capacity = hashed ? slots.size()*2 : smallCapacity*4;
+			rehash(capacity);
+		}
+		insertHashed(std::move(slot));
+	}
+	++_size;
+	return true;
+}
+
+std::shared_ptr<Tial::VFS::Object> Tial::VFS::DirectoryContent::erase(const std::string &name) {
+	if(_size == 0)
+		return nullptr;
+	size_t i = findSlot(name.data(), name.size(), hash(name, _caseSensitive));
+	if(i == slots.size())
+		return nullptr;
+
+	auto object = std::move(slots[i].object);
+	--_size;
+
+	if(!hashed) {
+		if(i != slots.size()-1)
+			slots[i] = std::move(slots.back());
+		slots.pop_back();
+		return object;
+	}
+
+	// backward shift deletion, so probe sequences never need tombstones
+	size_t mask = slots.size()-1;
+	for(size_t j = (i+1) & mask; slots[j].object; j = (j+1) & mask) {
+		size_t home = slots[j].hash & mask;
+		bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+		if(!between) {
+			slots[i] = std::move(slots[j]);
+			i = j;
+		}
+	}
+	slots[i] = Slot();
+	return object;
+}
+
+void Tial::VFS::DirectoryContent::reserve(size_t size) {
+	if(size <= smallCapacity) {
+		if(!hashed)
+			slots.reserve(size);
+		return;
+	}
+
+	size_t capacity = smallCapacity*4;
+	while(size*4 > capacity*3)
+		capacity *= 2;
+	if(!hashed || capacity > slots.size())
+		rehash(capacity);
+}
+
+void Tial::VFS::DirectoryContent::clear() {
+	slots.clear();
+	_size = 0;
+	hashed = false;
+}
+
+Tial::VFS::DirectoryContent::const_iterator Tial::VFS::DirectoryContent::begin() const {
+	return const_iterator(slots.data(), slots.data()+slots.size());
+}
+
+Tial::VFS::DirectoryContent::const_iterator Tial::VFS::DirectoryContent::end() const {
+	return const_iterator(slots.data()+slots.size(), slots.data()+slots.size());
+}
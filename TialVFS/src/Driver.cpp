@@ -1,11 +1,58 @@
 #include "Driver.hpp"
 #include "Directory.hpp"
 #include "Exception.hpp"
+#include "ThreadPool.hpp"
 
 #include <TialUtility/TialUtility.hpp>
 
+#include <algorithm>
+#include <atomic>
+
 #define TIAL_MODULE "Tial::VFS::Driver"
 
+namespace {
+
+class WholeFileWindow: public Tial::VFS::Driver::MappedWindow {
+	std::shared_ptr<Tial::VFS::Driver::MappedFile> file;
+	uintmax_t _offset;
+	size_t _length;
+
+public:
+	WholeFileWindow(const std::shared_ptr<Tial::VFS::Driver::MappedFile> &file, uintmax_t offset, size_t length)
+		: file(file), _offset(offset), _length(length) {}
+
+	virtual void *get() override {
+		return static_cast<char*>(file->get()) + _offset;
+	}
+
+	virtual uintmax_t offset() override {
+		return _offset;
+	}
+
+	virtual size_t length() override {
+		return _length;
+	}
+
+	virtual size_t size() override {
+		uintmax_t size = file->size();
+		return (size > _offset) ? static_cast<size_t>(std::min<uintmax_t>(size-_offset, _length)) : 0;
+	}
+
+	virtual void move(uintmax_t offset) override {
+		_offset = offset;
+	}
+
+	virtual void advise(Tial::VFS::Driver::Advice advice) override {
+		file->advise(advice, static_cast<size_t>(_offset), _length);
+	}
+
+	virtual void flush(bool async) override {
+		file->flush(static_cast<size_t>(_offset), _length, async);
+	}
+};
+
+}
+
 void Tial::VFS::Driver::mark(const Path &path, std::function<void(const std::shared_ptr<Object> &)> function) {
 	assert(!path.empty());
 	assert(path[0] == "/");
@@ -34,15 +81,419 @@ void Tial::VFS::Driver::markBroken(const Path &path) {
 
 Tial::VFS::Driver::OpenFile::~OpenFile() {}
 
+size_t Tial::VFS::Driver::OpenFile::readv(size_t pos, const std::vector<Buffer> &buffers) {
+	size_t total = 0;
+	for(const auto &buffer: buffers) {
+		size_t result = read(pos+total, buffer.data, buffer.size);
+		total += result;
+		if(result < buffer.size)
+			break;
+	}
+	return total;
+}
+
+size_t Tial::VFS::Driver::OpenFile::writev(size_t pos, const std::vector<ConstBuffer> &buffers) {
+	size_t total = 0;
+	for(const auto &buffer: buffers) {
+		size_t result = write(pos+total, buffer.data, buffer.size);
+		total += result;
+		if(result < buffer.size)
+			break;
+	}
+	return total;
+}
+
+void Tial::VFS::Driver::OpenFile::advise(Advice, uintmax_t, uintmax_t) {}
+
+void Tial::VFS::Driver::OpenFile::sync() {}
+
 Tial::VFS::Driver::MappedFile::~MappedFile() {}
 
+void Tial::VFS::Driver::MappedFile::advise(Advice, size_t, size_t) {}
+
+void Tial::VFS::Driver::MappedFile::populate() {}
+
+void Tial::VFS::Driver::MappedFile::flush(size_t, size_t, bool) {}
+
+Tial::VFS::Driver::MappedWindow::~MappedWindow() {}
+
+void Tial::VFS::Driver::MappedWindow::advise(Advice) {}
+
+void Tial::VFS::Driver::MappedWindow::flush(bool) {}
+
+void Tial::VFS::Driver::MappedFile::lock(bool exclusive) {
+	std::unique_lock<std::mutex> lock(mutex);
+	auto self = std::this_thread::get_id();
+	if(exclusive) {
+		// would wait for itself forever
+		if(writer != self && readers.count(self))
+			THROW Exceptions::MappingUpgrade();
+		++waitingWriters;
+		released.wait(lock, [this, self]() {
+			return (writes == 0 && readers.empty()) || writer == self;
+		});
+		--waitingWriters;
+		writer = self;
+		++writes;
+	} else {
+		// readers holding a lock already go first, otherwise they would wait for the writer waiting for them
+		released.wait(lock, [this, self]() {
+			return writer == self || (writes == 0 && (waitingWriters == 0 || readers.count(self)));
+		});
+		++readers[self];
+	}
+}
+
+void Tial::VFS::Driver::MappedFile::unlock(bool exclusive, std::thread::id holder) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if(exclusive) {
+			if(--writes == 0)
+				writer = std::thread::id();
+		} else {
+			auto i = readers.find(holder);
+			if(--i->second == 0)
+				readers.erase(i);
+		}
+	}
+	released.notify_all();
+}
+
+Tial::VFS::Driver::MappedFile::Exclusive::Exclusive(const std::shared_ptr<MappedFile> &file): file(file) {
+	if(file)
+		file->lock(true);
+}
+
+Tial::VFS::Driver::MappedFile::Exclusive::~Exclusive() {
+	if(file)
+		file->unlock(true, std::this_thread::get_id());
+}
+
+size_t Tial::VFS::Driver::MappedFile::capacity() {
+	return size();
+}
+
+void Tial::VFS::Driver::MappedFile::reserve(size_t) {}
+
+bool Tial::VFS::Driver::Attributes::Identity::operator==(const Identity &other) const {
+	return device == other.device && inode == other.inode;
+}
+
+bool Tial::VFS::Driver::Attributes::Identity::operator!=(const Identity &other) const {
+	return !(*this == other);
+}
+
+Tial::VFS::Driver::Attributes::Attributes(Kind kind): kind(kind) {}
+
+bool Tial::VFS::Driver::Attributes::complete() const {
+	return kind != Kind::Unknown && size && modificationTime && identity;
+}
+
 Tial::VFS::Driver::FileEntry::FileEntry(const std::string &fileName, bool directory):
-		fileName(fileName), directory(directory) {}
+		fileName(fileName), directory(directory),
+		attributes(directory ? Attributes::Kind::Directory : Attributes::Kind::File) {}
+
+Tial::VFS::Driver::FileEntry::FileEntry(const std::string &fileName, const Attributes &attributes):
+		fileName(fileName), directory(attributes.kind == Attributes::Kind::Directory), attributes(attributes) {}
+
+size_t Tial::VFS::Driver::Listing::size() const {
+	return entries.size();
+}
+
+bool Tial::VFS::Driver::Listing::empty() const {
+	return entries.empty();
+}
+
+const char *Tial::VFS::Driver::Listing::nameData(size_t i) const {
+	return names.data()+entries[i].offset;
+}
+
+size_t Tial::VFS::Driver::Listing::nameSize(size_t i) const {
+	return entries[i].size;
+}
+
+std::string Tial::VFS::Driver::Listing::name(size_t i) const {
+	return std::string(nameData(i), nameSize(i));
+}
+
+bool Tial::VFS::Driver::Listing::directory(size_t i) const {
+	return entries[i].directory;
+}
+
+const Tial::VFS::Driver::Attributes &Tial::VFS::Driver::Listing::attributes(size_t i) const {
+	static const Attributes file(Attributes::Kind::File), directory(Attributes::Kind::Directory);
+	if(i < _attributes.size())
+		return _attributes[i];
+	return entries[i].directory ? directory : file;
+}
+
+Tial::VFS::Driver::FileEntry Tial::VFS::Driver::Listing::entry(size_t i) const {
+	return FileEntry(name(i), attributes(i));
+}
+
+void Tial::VFS::Driver::Listing::append(const char *name, size_t size, bool directory) {
+	entries.push_back(Entry{names.size(), size, directory});
+	names.append(name, size);
+	names.push_back('\0');
+	if(!_attributes.empty())
+		_attributes.emplace_back(directory ? Attributes::Kind::Directory : Attributes::Kind::File);
+}
+
+void Tial::VFS::Driver::Listing::append(const char *name, size_t size, const Attributes &attributes) {
+	fillAttributes();
+	append(name, size, attributes.kind == Attributes::Kind::Directory);
+	if(_attributes.size() < entries.size())
+		_attributes.push_back(attributes);
+	else
+		_attributes.back() = attributes;
+}
+
+void Tial::VFS::Driver::Listing::setAttributes(size_t i, const Attributes &attributes) {
+	fillAttributes();
+	_attributes[i] = attributes;
+	entries[i].directory = (attributes.kind == Attributes::Kind::Directory);
+}
+
+void Tial::VFS::Driver::Listing::fillAttributes() {
+	// entries listed so far get only their kind
+	if(_attributes.size() < entries.size()) {
+		_attributes.reserve(entries.capacity());
+		for(size_t i = _attributes.size(); i < entries.size(); ++i)
+			_attributes.emplace_back(entries[i].directory ? Attributes::Kind::Directory : Attributes::Kind::File);
+	}
+}
+
+void Tial::VFS::Driver::Listing::reserve(size_t entries, size_t namesSize) {
+	this->entries.reserve(entries);
+	names.reserve(namesSize+entries);
+}
+
+void Tial::VFS::Driver::Listing::clear() {
+	names.clear();
+	entries.clear();
+	_attributes.clear();
+}
+
+Tial::VFS::Driver::Listing::ResumeToken Tial::VFS::Driver::Listing::resumeToken() const {
+	return _resumeToken;
+}
+
+const std::shared_ptr<void> &Tial::VFS::Driver::Listing::cursor() const {
+	return _cursor;
+}
+
+bool Tial::VFS::Driver::Listing::complete() const {
+	return _complete;
+}
+
+void Tial::VFS::Driver::Listing::suspend(ResumeToken token, const std::shared_ptr<void> &cursor) {
+	_resumeToken = token;
+	_cursor = cursor;
+	_complete = false;
+}
+
+void Tial::VFS::Driver::Listing::finish() {
+	_cursor.reset();
+	_complete = true;
+}
+
+void Tial::VFS::Driver::Listing::rewind() {
+	clear();
+	_resumeToken = 0;
+	_cursor.reset();
+	_complete = false;
+}
 
 Tial::VFS::Driver::Driver(const std::string &name): name(name) {}
 
 Tial::VFS::Driver::~Driver() {}
 
+boost::optional<Tial::VFS::Driver::FileEntry> Tial::VFS::Driver::tryGet(const Path &path) {
+	try {
+		return get(path);
+	} catch(const Exceptions::ElementNotFound &) {
+		return boost::none;
+	}
+}
+
+bool Tial::VFS::Driver::exists(const Path &path) {
+	return static_cast<bool>(tryGet(path));
+}
+
+std::vector<Tial::VFS::Driver::FileEntry> Tial::VFS::Driver::listDirectory(const Path &path, const NamePattern &filter) {
+	auto entries = listDirectory(path);
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [&filter](const FileEntry &entry) {
+		return !filter.matches(entry.fileName);
+	}), entries.end());
+	return entries;
+}
+
+void Tial::VFS::Driver::listDirectory(const Path &path, Listing &listing, size_t limit, const NamePattern &filter) {
+	listing.clear();
+	if(listing.complete())
+		return;
+
+	// resume token is simply the index of first entry not returned yet
+	auto entries = listDirectory(path, filter);
+	size_t begin = std::min<size_t>(listing.resumeToken(), entries.size());
+	size_t end = (limit == 0) ? entries.size() : std::min(entries.size(), begin+limit);
+	for(size_t i = begin; i < end; ++i)
+		listing.append(entries[i].fileName.data(), entries[i].fileName.size(), entries[i].attributes);
+
+	if(end == entries.size())
+		listing.finish();
+	else
+		listing.suspend(end);
+}
+
+std::shared_ptr<Tial::VFS::Driver::MappedWindow> Tial::VFS::Driver::mapWindow(
+	const Path &path, uintmax_t offset, size_t length, bool, bool populate
+) {
+	LOGN2 << "path = " << path << ", offset = " << offset << ", length = " << length;
+	auto file = map(path);
+	if(populate)
+		file->populate();
+	return std::make_shared<WholeFileWindow>(file, offset, length);
+}
+
+Tial::VFS::Driver::ViewedRange Tial::VFS::Driver::view(const Path &path, uintmax_t offset, size_t length) {
+	LOGN2 << "path = " << path << ", offset = " << offset << ", length = " << length;
+	return copyRange(*open(path), offset, length);
+}
+
+Tial::VFS::Driver::ViewedRange Tial::VFS::Driver::copyRange(OpenFile &file, uintmax_t offset, size_t length) {
+	size_t size = file.size();
+	if(offset >= size)
+		return ViewedRange();
+	length = std::min<size_t>(length, size-offset);
+
+	auto buffer = std::make_shared<std::vector<uint8_t>>(length);
+	size_t done = 0;
+	while(done < length) {
+		size_t transferred = file.read(offset+done, buffer->data()+done, length-done);
+		if(transferred == 0)
+			break;
+		done += transferred;
+	}
+	buffer->resize(done);
+
+	ViewedRange range;
+	range.owner = buffer;
+	range.data = buffer->data();
+	range.size = buffer->size();
+	return range;
+}
+
+void Tial::VFS::Driver::readMany(std::vector<ReadRequest> &requests, ThreadPool &pool, size_t queueDepth) {
+	LOGN1 << "requests = " << requests.size() << ", queueDepth = " << queueDepth;
+
+	// every task takes next request until none is left, so number of tasks bounds the depth
+	std::atomic<size_t> next{0};
+	auto task = [this, &requests, &next]() {
+		for(size_t i; (i = next++) < requests.size();) {
+			auto &request = requests[i];
+			try {
+				request.transferred = 0;
+				request.error = nullptr;
+				request.transferred = open(request.path)->readv(request.offset, {request.buffer});
+			} catch(...) {
+				request.error = std::current_exception();
+			}
+		}
+	};
+
+	TaskGroup group(pool);
+	size_t tasks = std::min(std::max<size_t>(queueDepth, 1), requests.size());
+	for(size_t i = 0; i < tasks; ++i)
+		group.run(task);
+	group.wait();
+}
+
+Tial::VFS::Task<Tial::VFS::Driver::FileEntry> Tial::VFS::Driver::getAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		return self->get(path);
+	});
+}
+
+Tial::VFS::Task<std::vector<Tial::VFS::Driver::FileEntry>> Tial::VFS::Driver::listDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		return self->listDirectory(path);
+	});
+}
+
+Tial::VFS::Task<uintmax_t> Tial::VFS::Driver::sizeAsync(const Path &path, const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		return self->size(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::Driver::resizeAsync(const Path &path, uintmax_t size,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path, size]() {
+		self->resize(path, size);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::Driver::createFileAsync(const Path &path, const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		self->createFile(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::Driver::removeFileAsync(const Path &path, const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		self->removeFile(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::Driver::createDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		self->createDirectory(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::Driver::removeDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		self->removeDirectory(path);
+	});
+}
+
+Tial::VFS::Task<std::shared_ptr<Tial::VFS::Driver::OpenFile>> Tial::VFS::Driver::openAsync(const Path &path,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path]() {
+		return self->open(path);
+	});
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::Driver::readAsync(const Path &path, uintmax_t pos, const Buffer &buffer,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path, pos, buffer]() {
+		return self->open(path)->read(pos, buffer.data, buffer.size);
+	});
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::Driver::writeAsync(const Path &path, uintmax_t pos, const ConstBuffer &buffer,
+		const std::shared_ptr<Executor> &executor) {
+	auto self = shared_from_this();
+	return async(*executor, [self, path, pos, buffer]() {
+		return self->open(path)->write(pos, buffer.data, buffer.size);
+	});
+}
+
 void Tial::VFS::Driver::registerMountPoint(const std::shared_ptr<Directory> &directory) {
 	mountPoints.push_back(directory);
 }
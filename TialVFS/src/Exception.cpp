@@ -34,3 +34,12 @@ Tial::VFS::Exceptions::UnassignedAccessor::UnassignedAccessor(const std::string
 
 Tial::VFS::Exceptions::AlreadyOpened::AlreadyOpened()
 	: Exception("Stream already opened") {}
+
+Tial::VFS::Exceptions::ReadOnlyAccessor::ReadOnlyAccessor(const std::string &accessorType)
+	: Exception("Modifying read-only accessor: "+accessorType), accessorType(accessorType) {}
+
+Tial::VFS::Exceptions::MappingUpgrade::MappingUpgrade()
+	: Exception("Read-only mapping cannot be upgraded") {}
+
+Tial::VFS::Exceptions::FileViewed::FileViewed(const Path &path)
+	: Exception("File is viewed past requested size: "+std::string(path)), path(path) {}
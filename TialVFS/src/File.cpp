@@ -1,28 +1,32 @@
 #include "File.hpp"
 #include "Directory.hpp"
 #include "Exception.hpp"
+#include "Root.hpp"
 
 #include <TialUtility/TialUtility.hpp>
 
 #define TIAL_MODULE "Tial::VFS::File"
 
-Tial::VFS::FileDevice::FileDevice(const std::shared_ptr<Driver::OpenFile> &file): file(file) {}
+Tial::VFS::FileDevice::FileDevice(const std::shared_ptr<Driver::OpenFile> &file, const std::weak_ptr<File> &owner)
+	: file(file), owner(owner) {}
 
 std::streamsize Tial::VFS::FileDevice::read(char *buffer, std::streamsize bufferSize) const {
-	LOGN1 << "buffer = " << static_cast<const void*>(buffer) << ", bufferSize = " << bufferSize
+	LOGN3 << "buffer = " << static_cast<const void*>(buffer) << ", bufferSize = " << bufferSize
 		<< ", this->pos = " << static_cast<int>(pos);
 	auto result = file->read(pos, buffer, bufferSize);
-	LOGN1 << "result = " << result;
+	LOGN3 << "result = " << result;
 	pos += result;
 	return result;
 }
 
 std::streamsize Tial::VFS::FileDevice::write(const char *buffer, std::streamsize bufferSize) {
-	LOGN1 << "buffer = " << static_cast<const void*>(buffer) << ", bufferSize = " << bufferSize
+	LOGN3 << "buffer = " << static_cast<const void*>(buffer) << ", bufferSize = " << bufferSize
 		<< ", this->pos = " << static_cast<int>(pos);
 	auto result = file->write(pos, buffer, bufferSize);
 	pos += result;
-	LOGN1 << "result = " << result;
+	if(auto f = owner.lock())
+		f->attributesChanged();
+	LOGN3 << "result = " << result;
 	return result;
 }
 
@@ -48,9 +52,11 @@ std::streamsize Tial::VFS::FileDevice::size() const {
 
 Tial::VFS::Stream::Stream(
 	const std::shared_ptr<Driver::OpenFile> &file,
+	const std::weak_ptr<File> &owner,
 	intmax_t offset,
-	std::ios_base::seekdir direction
-): _device(FileDevice(file)) {
+	std::ios_base::seekdir direction,
+	size_t bufferSize
+): _device(FileDevice(file, owner)), _bufferSize(bufferSize) {
 	open(_device);
 	seekg(offset, direction);
 	seekp(offset, direction);
@@ -65,7 +71,10 @@ void Tial::VFS::Stream::open(const FileDevice &device) {
 		THROW Exceptions::AlreadyOpened();
 
 	_device = device;
-	boost::iostreams::stream<FileDevice>::open(device);
+	if(_bufferSize > 0)
+		boost::iostreams::stream<FileDevice>::open(device, static_cast<std::streamsize>(_bufferSize));
+	else
+		boost::iostreams::stream<FileDevice>::open(device);
 }
 
 const Tial::VFS::FileDevice *Tial::VFS::Stream::operator->() const {
@@ -77,8 +86,9 @@ Tial::VFS::Stream::Stream() {}
 Tial::VFS::Stream& Tial::VFS::Stream::operator=(const Tial::VFS::Stream &stream) {
 	if(is_open())
 		close();
+	_bufferSize = stream._bufferSize;
 	if(stream->file) {
-		open(FileDevice(stream->file));
+		open(FileDevice(stream->file, stream->owner));
 		seekg(stream->tell(), beg);
 		seekp(stream->tell(), beg);
 	}
@@ -89,11 +99,127 @@ std::streamsize Tial::VFS::Stream::size() const {
 	return _device.size();
 }
 
-Tial::VFS::Mapping::Mapping(const std::shared_ptr<File> &file): file(file->_map()), lock(this->file->mutex) {}
+size_t Tial::VFS::Stream::bufferSize() const {
+	return _bufferSize;
+}
+
+void Tial::VFS::Stream::advise(Driver::Advice advice, uintmax_t offset, uintmax_t length) {
+	if(!_device.file)
+		THROW Exceptions::UnassignedAccessor("Stream");
+	_device.file->advise(advice, offset, length);
+}
+
+Tial::VFS::View::View(const Driver::ViewedRange &range): range(range) {}
+
+const void *Tial::VFS::View::data() const {
+	return range.data;
+}
+
+size_t Tial::VFS::View::size() const {
+	return range.size;
+}
+
+bool Tial::VFS::View::empty() const {
+	return range.size == 0;
+}
+
+const char *Tial::VFS::View::begin() const {
+	return static_cast<const char*>(range.data);
+}
+
+const char *Tial::VFS::View::end() const {
+	return begin()+range.size;
+}
+
+Tial::VFS::Handle::Handle(const std::shared_ptr<Driver::OpenFile> &file, const std::weak_ptr<File> &owner)
+	: file(file), owner(owner) {}
+
+const std::shared_ptr<Tial::VFS::Driver::OpenFile> &Tial::VFS::Handle::checked() const {
+	if(!file)
+		THROW Exceptions::UnassignedAccessor("Handle");
+	return file;
+}
+
+size_t Tial::VFS::Handle::read(uintmax_t pos, const Driver::Buffer &buffer) const {
+	return checked()->read(pos, buffer.data, buffer.size);
+}
+
+size_t Tial::VFS::Handle::write(uintmax_t pos, const Driver::ConstBuffer &buffer) const {
+	auto result = checked()->write(pos, buffer.data, buffer.size);
+	if(auto f = owner.lock())
+		f->attributesChanged();
+	return result;
+}
+
+size_t Tial::VFS::Handle::read(uintmax_t pos, const std::vector<Driver::Buffer> &buffers) const {
+	return checked()->readv(pos, buffers);
+}
+
+size_t Tial::VFS::Handle::write(uintmax_t pos, const std::vector<Driver::ConstBuffer> &buffers) const {
+	auto result = checked()->writev(pos, buffers);
+	if(auto f = owner.lock())
+		f->attributesChanged();
+	return result;
+}
+
+uintmax_t Tial::VFS::Handle::size() const {
+	return checked()->size();
+}
+
+bool Tial::VFS::Handle::assigned() const {
+	return static_cast<bool>(file);
+}
+
+Tial::VFS::Handle::operator bool() const {
+	return assigned();
+}
+
+bool Tial::VFS::Handle::operator!() const {
+	return !static_cast<bool>(*this);
+}
+
+Tial::VFS::Mapping::Mapping(const std::shared_ptr<File> &file, Access access, bool populate)
+		: file(file->_map()), _access(access), owner(file), holder(std::this_thread::get_id()) {
+	this->file->lock(access == Access::ReadWrite);
+	if(populate) {
+		try {
+			this->file->populate();
+		} catch(...) {
+			release();
+			throw;
+		}
+	}
+}
+
+Tial::VFS::Mapping::~Mapping() {
+	release();
+}
+
+void Tial::VFS::Mapping::release() {
+	if(!file)
+		return;
+	file->unlock(_access == Access::ReadWrite, holder);
+	file.reset();
+
+	// contents could have been modified through the mapping
+	if(_access == Access::ReadWrite)
+		if(auto f = owner.lock())
+			f->attributesChanged();
+}
+
+void Tial::VFS::Mapping::checkWritable() const {
+	if(!file)
+		THROW Exceptions::UnassignedAccessor("Mapping");
+	if(_access != Access::ReadWrite)
+		THROW Exceptions::ReadOnlyAccessor("Mapping");
+}
 
 Tial::VFS::Mapping &Tial::VFS::Mapping::operator=(Mapping &&other) {
-	lock = std::move(other.lock);
+	release();
 	file = std::move(other.file);
+	_access = other._access;
+	owner = std::move(other.owner);
+	holder = other.holder;
 	return *this;
 }
 
@@ -112,9 +238,40 @@ size_t Tial::VFS::Mapping::size() const {
 
 void Tial::VFS::Mapping::resize(size_t size) {
 	LOGN1;
+	checkWritable();
+	file->resize(size);
+	if(auto f = owner.lock())
+		f->attributesChanged();
+}
+
+size_t Tial::VFS::Mapping::capacity() const {
 	if(!file)
 		THROW Exceptions::UnassignedAccessor("Mapping");
-	file->resize(size);
+	return file->capacity();
+}
+
+void Tial::VFS::Mapping::reserve(size_t capacity) {
+	LOGN1 << "capacity = " << capacity;
+	checkWritable();
+	file->reserve(capacity);
+}
+
+void Tial::VFS::Mapping::advise(Driver::Advice advice, size_t offset, size_t length) {
+	LOGN2 << "offset = " << offset << ", length = " << length;
+	if(!file)
+		THROW Exceptions::UnassignedAccessor("Mapping");
+	file->advise(advice, offset, length);
+}
+
+void Tial::VFS::Mapping::flush(size_t offset, size_t length, bool async) {
+	LOGN2 << "offset = " << offset << ", length = " << length << ", async = " << async;
+	if(!file)
+		THROW Exceptions::UnassignedAccessor("Mapping");
+	file->flush(offset, length, async);
+}
+
+Tial::VFS::Mapping::Access Tial::VFS::Mapping::access() const {
+	return _access;
 }
 
 bool Tial::VFS::Mapping::assigned() const {
@@ -129,6 +286,105 @@ bool Tial::VFS::Mapping::operator!() const {
 	return !static_cast<bool>(*this);
 }
 
+Tial::VFS::Window::Window(const std::shared_ptr<File> &file, uintmax_t offset, size_t length,
+		Mapping::Access access, bool populate)
+	: window(file->_mapWindow(offset, length, access == Mapping::Access::ReadWrite, populate)),
+	_access(access), owner(file) {}
+
+Tial::VFS::Window::~Window() {
+	release();
+}
+
+void Tial::VFS::Window::release() {
+	if(!window)
+		return;
+	window.reset();
+
+	// contents could have been modified through the window
+	if(_access == Mapping::Access::ReadWrite)
+		if(auto f = owner.lock())
+			f->attributesChanged();
+}
+
+Tial::VFS::Window &Tial::VFS::Window::operator=(Window &&other) {
+	release();
+	window = std::move(other.window);
+	_access = other._access;
+	owner = std::move(other.owner);
+	return *this;
+}
+
+const std::shared_ptr<Tial::VFS::Driver::MappedWindow> &Tial::VFS::Window::checked() const {
+	if(!window)
+		THROW Exceptions::UnassignedAccessor("Window");
+	return window;
+}
+
+uintmax_t Tial::VFS::Window::offset() const {
+	return checked()->offset();
+}
+
+size_t Tial::VFS::Window::length() const {
+	return checked()->length();
+}
+
+size_t Tial::VFS::Window::size() const {
+	return checked()->size();
+}
+
+void *Tial::VFS::Window::get() const {
+	return checked()->get();
+}
+
+void Tial::VFS::Window::move(uintmax_t offset) {
+	LOGN2 << "offset = " << offset;
+	checked()->move(offset);
+}
+
+bool Tial::VFS::Window::next() {
+	auto &w = checked();
+	w->move(w->offset() + w->length());
+	return w->size() > 0;
+}
+
+bool Tial::VFS::Window::contains(uintmax_t position, size_t length) const {
+	auto &w = checked();
+	return position >= w->offset() && position + length <= w->offset() + w->length();
+}
+
+void *Tial::VFS::Window::at(uintmax_t position, size_t length) {
+	auto &w = checked();
+	if(length > w->length())
+		THROW Exception("Range of " + std::to_string(length) + " bytes does not fit in window");
+	if(!contains(position, length))
+		w->move(position);
+	return static_cast<char*>(w->get()) + (position - w->offset());
+}
+
+void Tial::VFS::Window::advise(Driver::Advice advice) {
+	checked()->advise(advice);
+}
+
+void Tial::VFS::Window::flush(bool async) {
+	checked()->flush(async);
+}
+
+Tial::VFS::Mapping::Access Tial::VFS::Window::access() const {
+	return _access;
+}
+
+bool Tial::VFS::Window::assigned() const {
+	return static_cast<bool>(window);
+}
+
+Tial::VFS::Window::operator bool() const {
+	return assigned();
+}
+
+bool Tial::VFS::Window::operator!() const {
+	return !static_cast<bool>(*this);
+}
+
 Tial::VFS::File::File(
 	const std::shared_ptr<Root> &root,
 	const std::shared_ptr<Directory> &parent,
@@ -145,6 +401,12 @@ std::shared_ptr<Tial::VFS::Driver::MappedFile> Tial::VFS::File::_map() {
 	return d.second->map(d.first/name());
 }
 
+std::shared_ptr<Tial::VFS::Driver::MappedWindow> Tial::VFS::File::_mapWindow(uintmax_t offset, size_t length,
+		bool writable, bool populate) {
+	auto d = parent()->driver();
+	return d.second->mapWindow(d.first/name(), offset, length, writable, populate);
+}
+
 void Tial::VFS::File::validate() {
 	LOGN2;
 
@@ -152,45 +414,204 @@ void Tial::VFS::File::validate() {
 		return;
 
 	checkIfBroken();
+	auto epoch = validateParent();
 
 	LOGN1 << "*this = " << *this;
 
 	auto d = parent()->driver();
 
-	try {
-		auto entry = d.second->get(d.first/_name);
-	} catch(const Exceptions::ElementNotFound &e) {
+	auto entry = d.second->tryGet(d.first/_name);
+	if(!entry)
 		markBroken();
-	}
+	else
+		setAttributes(entry->attributes);
 
-	markValid();
+	markValid(epoch);
 }
 
-Tial::VFS::Stream Tial::VFS::File::open(intmax_t offset, std::ios_base::seekdir direction) {
+void Tial::VFS::File::setAttributes(const Driver::Attributes &attributes) {
+	std::unique_lock<std::mutex> lock(attributesMutex);
+	_attributes = attributes;
+}
+
+void Tial::VFS::File::attributesChanged() {
+	std::unique_lock<std::mutex> lock(attributesMutex);
+	_attributes.size = boost::none;
+	_attributes.modificationTime = boost::none;
+}
+
+Tial::VFS::Stream Tial::VFS::File::open(intmax_t offset, std::ios_base::seekdir direction, size_t bufferSize) {
+	validate();
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	return Stream(self->_open(), self, offset, direction, bufferSize);
+}
+
+Tial::VFS::Handle Tial::VFS::File::handle() {
+	validate();
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	return Handle(self->_open(), self);
+}
+
+size_t Tial::VFS::File::read(uintmax_t pos, const Driver::Buffer &buffer) {
 	validate();
-	return Stream(std::dynamic_pointer_cast<File>(shared_from_this())->_open(), offset, direction);
+	return _open()->read(pos, buffer.data, buffer.size);
 }
 
-Tial::VFS::Mapping Tial::VFS::File::map() {
+size_t Tial::VFS::File::write(uintmax_t pos, const Driver::ConstBuffer &buffer) {
 	validate();
-	return Mapping(std::dynamic_pointer_cast<File>(shared_from_this()));
+	auto result = _open()->write(pos, buffer.data, buffer.size);
+	attributesChanged();
+	return result;
+}
+
+Tial::VFS::Mapping Tial::VFS::File::map(Mapping::Access access, bool populate) {
+	validate();
+	return Mapping(std::dynamic_pointer_cast<File>(shared_from_this()), access, populate);
+}
+
+Tial::VFS::Window Tial::VFS::File::map(uintmax_t offset, size_t length, Mapping::Access access, bool populate) {
+	LOGN1 << "offset = " << offset << ", length = " << length;
+	validate();
+	return Window(std::dynamic_pointer_cast<File>(shared_from_this()), offset, length, access, populate);
+}
+
+Tial::VFS::View Tial::VFS::File::view(uintmax_t offset, size_t length) {
+	LOGN1 << "offset = " << offset << ", length = " << length;
+	validate();
+	auto d = parent()->driver();
+	return View(d.second->view(d.first/name(), offset, length));
+}
+
+void Tial::VFS::File::advise(Driver::Advice advice, uintmax_t offset, uintmax_t length) {
+	LOGN1 << "offset = " << offset << ", length = " << length;
+	validate();
+	_open()->advise(advice, offset, length);
+}
+
+void Tial::VFS::File::sync() {
+	LOGN1;
+	validate();
+	_open()->sync();
+}
+
+Tial::VFS::Driver::Attributes Tial::VFS::File::attributes() {
+	validate();
+	{
+		std::unique_lock<std::mutex> lock(attributesMutex);
+		if(_attributes.complete())
+			return _attributes;
+	}
+
+	LOGN2 << "Attributes of " << *this << " are not cached, asking driver";
+	auto d = parent()->driver();
+	auto attributes = d.second->get(d.first/name()).attributes;
+	setAttributes(attributes);
+	return attributes;
 }
 
 uintmax_t Tial::VFS::File::size() {
 	validate();
+	{
+		std::unique_lock<std::mutex> lock(attributesMutex);
+		if(_attributes.size)
+			return *_attributes.size;
+	}
+
 	auto d = parent()->driver();
-	return d.second->size(d.first/name());
+	auto size = d.second->size(d.first/name());
+	std::unique_lock<std::mutex> lock(attributesMutex);
+	_attributes.size = size;
+	return size;
 }
 
 void Tial::VFS::File::resize(uintmax_t size) {
 	validate();
 	auto d = parent()->driver();
+	attributesChanged();
 	d.second->resize(d.first/name(), size);
+	std::unique_lock<std::mutex> lock(attributesMutex);
+	_attributes.size = size;
+}
+
+Tial::VFS::Task<Tial::VFS::Stream> Tial::VFS::File::openAsync(intmax_t offset, std::ios_base::seekdir direction) {
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	return async(*root()->executor(), [self, offset, direction]() {
+		return self->open(offset, direction);
+	});
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::File::readAsync(uintmax_t pos, const Driver::Buffer &buffer) {
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	auto executor = root()->executor();
+	if(valid() == Validity::Valid) {
+		auto d = parent()->driver();
+		return d.second->readAsync(d.first/_name, pos, buffer, executor);
+	}
+
+	return async(*executor, [self, pos, buffer]() {
+		return self->read(pos, buffer);
+	});
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::File::writeAsync(uintmax_t pos, const Driver::ConstBuffer &buffer) {
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	auto executor = root()->executor();
+	attributesChanged();
+	if(valid() == Validity::Valid) {
+		auto d = parent()->driver();
+		return after(d.second->writeAsync(d.first/_name, pos, buffer, executor), [self]() {
+			self->attributesChanged();
+		});
+	}
+
+	return async(*executor, [self, pos, buffer]() {
+		return self->write(pos, buffer);
+	});
+}
+
+Tial::VFS::Task<uintmax_t> Tial::VFS::File::sizeAsync() {
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	auto executor = root()->executor();
+	if(valid() == Validity::Valid) {
+		{
+			std::unique_lock<std::mutex> lock(attributesMutex);
+			if(_attributes.size) {
+				uintmax_t size = *_attributes.size;
+				return completed([size]() {
+					return size;
+				});
+			}
+		}
+		auto d = parent()->driver();
+		return d.second->sizeAsync(d.first/_name, executor);
+	}
+
+	return async(*executor, [self]() {
+		return self->size();
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::File::resizeAsync(uintmax_t size) {
+	auto self = std::dynamic_pointer_cast<File>(shared_from_this());
+	auto executor = root()->executor();
+	if(valid() == Validity::Valid) {
+		attributesChanged();
+		auto d = parent()->driver();
+		return after(d.second->resizeAsync(d.first/_name, size, executor), [self]() {
+			self->attributesChanged();
+		});
+	}
+
+	return async(*executor, [self, size]() {
+		self->resize(size);
+	});
 }
 
 void Tial::VFS::File::remove() {
 	validate();
-	auto d = parent()->driver();
+	auto p = parent();
+	auto d = p->driver();
 	d.second->removeFile(d.first/name());
+	p->eraseRemoved(*this);
 	markBroken();
 }
@@ -0,0 +1,182 @@
+#include "Glob.hpp"
+#include "Exception.hpp"
+#include "Object.hpp"
+#include "ThreadPool.hpp"
+#include "Root.hpp"
+
+#include <TialUtility/TialUtility.hpp>
+
+#include <algorithm>
+
+#define TIAL_MODULE "Tial::VFS::Glob"
+
+namespace {
+
+inline uint64_t bit(size_t i) {
+	return uint64_t(1) << i;
+}
+
+// position of the only bit set
+inline size_t index(uint64_t state) {
+	size_t i = 0;
+	while(state >>= 1)
+		++i;
+	return i;
+}
+
+}
+
+Tial::VFS::Glob::Glob(const Path &pattern): _pattern(pattern) {
+	for(const auto &segment: pattern)
+		segments.push_back(Segment{segment == "**", NamePattern(segment)});
+	if(segments.size() > maxSegments)
+		THROW Exceptions::InvalidPath(pattern);
+}
+
+const Tial::VFS::Path &Tial::VFS::Glob::pattern() const {
+	return _pattern;
+}
+
+uint64_t Tial::VFS::Glob::accepting() const {
+	return bit(segments.size());
+}
+
+bool Tial::VFS::Glob::literalsOnly(uint64_t states) const {
+	for(size_t i = 0; i < segments.size(); ++i)
+		if((states & bit(i)) && (segments[i].recursive || segments[i].name.kind() != NamePattern::Kind::Literal))
+			return false;
+	return true;
+}
+
+uint64_t Tial::VFS::Glob::transitions(uint64_t states, const std::string &name, bool caseSensitive) const {
+	uint64_t next = 0;
+	for(size_t i = 0; i < segments.size(); ++i) {
+		if(!(states & bit(i)))
+			continue;
+		if(segments[i].recursive)
+			next |= bit(i) | bit(i+1); // stay inside "**" or continue with rest of pattern
+		else if(segments[i].name.matches(name, caseSensitive))
+			next |= bit(i+1);
+	}
+	return next;
+}
+
+void Tial::VFS::Glob::visit(const std::shared_ptr<Object> &object, uint64_t states, Context &context) const {
+	if(states & accepting()) {
+		std::unique_lock<std::mutex> lock(context.mutex);
+		if(context.stopped)
+			return;
+		LOGN3 << "Found matching element " << object->_name;
+		context.results.push_back(object);
+		if(context.limit != 0 && context.results.size() >= context.limit)
+			context.stopped = true;
+		states &= ~accepting();
+	}
+
+	if(!states || context.stopped)
+		return;
+	auto directory = dynamic_cast<Directory*>(object.get());
+	if(!directory)
+		return;
+
+	if(context.group) {
+		auto shared = std::static_pointer_cast<Directory>(object);
+		context.group->run([this, shared, states, &context]() {
+			match(*shared, states, context);
+		});
+	} else {
+		match(*directory, states, context);
+	}
+}
+
+void Tial::VFS::Glob::match(Directory &directory, uint64_t states, Context &context) const {
+	if(context.stopped)
+		return;
+
+	// single name pattern in directory not listed yet is left to the driver, so entries
+	// that cannot match are neither listed nor cached
+	if(directory.valid() != Object::Validity::Valid && (states & (states-1)) == 0) {
+		const auto &segment = segments[index(states)];
+		if(!segment.recursive && segment.name.kind() != NamePattern::Kind::Literal) {
+			for(const auto &child: directory.content(segment.name)) {
+				if(context.stopped)
+					return;
+				visit(child, states << 1, context);
+			}
+			return;
+		}
+	}
+
+	directory.validate();
+
+	if(!literalsOnly(states)) {
+		// validating a child may list this directory again on the same thread
+		Directory::Iteration iteration(directory);
+		bool caseSensitive = iteration.content().caseSensitive();
+		for(const auto &child: iteration.content()) {
+			if(context.stopped)
+				return;
+			if(auto next = transitions(states, child->_name, caseSensitive))
+				visit(child, next, context);
+		}
+		return;
+	}
+
+	// literal segments are probed directly; several states may lead to the same element
+	std::vector<std::pair<std::shared_ptr<Object>, uint64_t>> found;
+	{
+		std::unique_lock<std::recursive_mutex> lock(directory.mutex);
+		const auto &content = directory.currentContent();
+		for(size_t i = 0; i < segments.size(); ++i) {
+			if(!(states & bit(i)))
+				continue;
+			auto child = content.find(segments[i].name.text());
+			if(!child)
+				continue;
+			auto same = std::find_if(found.begin(), found.end(), [child](const std::pair<std::shared_ptr<Object>, uint64_t> &f) {
+				return f.first == *child;
+			});
+			if(same != found.end())
+				same->second |= bit(i+1);
+			else
+				found.emplace_back(*child, bit(i+1));
+		}
+	}
+	for(const auto &f: found)
+		visit(f.first, f.second, context);
+}
+
+std::vector<std::shared_ptr<Tial::VFS::Object>> Tial::VFS::Glob::match(const std::shared_ptr<Directory> &directory,
+		size_t limit, Directory::Traversal traversal) const {
+	LOGN1 << "Matching " << _pattern << " in " << directory->path();
+
+	if(segments.empty())
+		return {directory};
+
+	Context context;
+	context.limit = limit;
+
+	std::shared_ptr<ThreadPool> pool;
+	if(traversal == Directory::Traversal::Parallel)
+		if(auto root = directory->root())
+			pool = root->threadPool();
+
+	if(pool) {
+		TaskGroup group(*pool);
+		context.group = &group;
+		match(*directory, bit(0), context);
+		group.wait();
+	} else {
+		match(*directory, bit(0), context);
+	}
+
+	LOGN2 << "Found " << context.results.size() << " elements";
+	return std::move(context.results);
+}
+
+std::shared_ptr<Tial::VFS::Object> Tial::VFS::Glob::first(const std::shared_ptr<Directory> &directory) const {
+	auto results = match(directory, 1);
+	if(results.empty())
+		return nullptr;
+	return results[0];
+}
@@ -0,0 +1,77 @@
+#include "GroupCommit.hpp"
+#include "File.hpp"
+
+#include <TialUtility/TialUtility.hpp>
+
+#define TIAL_MODULE "Tial::VFS::GroupCommit"
+
+Tial::VFS::GroupCommit::GroupCommit(const std::shared_ptr<File> &file): GroupCommit([file]() {
+	file->sync();
+}) {}
+
+Tial::VFS::GroupCommit::GroupCommit(std::function<void()> commit): commit(std::move(commit)) {
+	syncer = std::thread(&GroupCommit::run, this);
+}
+
+Tial::VFS::GroupCommit::~GroupCommit() {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	requested.notify_one();
+	syncer.join();
+}
+
+void Tial::VFS::GroupCommit::run() {
+	for(;;) {
+		std::vector<Promise<void>> batch;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			requested.wait(lock, [this]() {
+				return stopping || !pending.empty();
+			});
+			if(pending.empty())
+				return;
+			batch.swap(pending);
+		}
+
+		// requests arriving from now on wait for the next batch
+		LOGN2 << "Syncing " << batch.size() << " requests";
+		++_batches;
+		std::exception_ptr error;
+		try {
+			commit();
+		} catch(...) {
+			error = std::current_exception();
+		}
+		for(auto &promise: batch) {
+			if(error)
+				promise.setException(error);
+			else
+				promise.setValue();
+		}
+	}
+}
+
+void Tial::VFS::GroupCommit::sync() {
+	syncAsync().get();
+}
+
+Tial::VFS::Task<void> Tial::VFS::GroupCommit::syncAsync() {
+	Promise<void> promise;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		pending.push_back(promise);
+	}
+	++_requests;
+	requested.notify_one();
+	return promise.task();
+}
+
+uintmax_t Tial::VFS::GroupCommit::requests() const {
+	return _requests;
+}
+
+uintmax_t Tial::VFS::GroupCommit::batches() const {
+	return _batches;
+}
@@ -0,0 +1,131 @@
+#include "LookupCache.hpp"
+#include "Object.hpp"
+
+#include <TialUtility/TialUtility.hpp>
+
+#define TIAL_MODULE "Tial::VFS::LookupCache"
+
+bool Tial::VFS::LookupCache::Key::operator==(const Key &other) const {
+	return base == other.base && path == other.path;
+}
+
+size_t Tial::VFS::LookupCache::KeyHash::operator()(const Key &key) const {
+	return std::hash<std::string>()(key.path) ^ (std::hash<const Object*>()(key.base) << 1);
+}
+
+Tial::VFS::LookupCache::LookupCache(size_t capacity, size_t negativeCapacity)
+	: _capacity(capacity), _negativeCapacity(negativeCapacity) {}
+
+bool Tial::VFS::LookupCache::find(const Object &base, const std::string &path, std::shared_ptr<Object> &object) {
+	std::unique_lock<std::mutex> lock(mutex);
+	Key key{&base, path};
+
+	auto i = entries.find(key);
+	if(i != entries.end()) {
+		if(i->second.stamp.epoch == _epoch && !i->second.base.expired()) {
+			if((object = i->second.object.lock())) {
+				++_hits;
+				return true;
+			}
+		}
+		entries.erase(i);
+	}
+
+	auto j = negativeEntries.find(key);
+	if(j != negativeEntries.end()) {
+		if(j->second.stamp.epoch == _epoch && j->second.stamp.negativeEpoch == _negativeEpoch
+				&& !j->second.base.expired()) {
+			object.reset();
+			++_negativeHits;
+			return true;
+		}
+		negativeEntries.erase(j);
+	}
+
+	++_misses;
+	return false;
+}
+
+void Tial::VFS::LookupCache::insert(const std::shared_ptr<Object> &base, const std::string &path,
+		const std::shared_ptr<Object> &object, const Stamp &stamp) {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// something was invalidated while the caller was resolving the path
+	if(stamp.epoch != _epoch)
+		return;
+
+	if(object) {
+		if(_capacity == 0)
+			return;
+		if(entries.size() >= _capacity) {
+			LOGN2 << "Lookup cache is full, dropping " << entries.size() << " entries";
+			entries.clear();
+		}
+		entries[Key{base.get(), path}] = Entry{base, object, stamp};
+	} else {
+		if(stamp.negativeEpoch != _negativeEpoch || _negativeCapacity == 0)
+			return;
+		if(negativeEntries.size() >= _negativeCapacity) {
+			LOGN2 << "Negative lookup cache is full, dropping " << negativeEntries.size() << " entries";
+			negativeEntries.clear();
+		}
+		negativeEntries[Key{base.get(), path}] = Entry{base, std::weak_ptr<Object>(), stamp};
+	}
+}
+
+Tial::VFS::LookupCache::Stamp Tial::VFS::LookupCache::stamp() const {
+	return Stamp{_epoch, _negativeEpoch};
+}
+
+void Tial::VFS::LookupCache::invalidate() {
+	++_epoch;
+}
+
+void Tial::VFS::LookupCache::invalidateNegative() {
+	++_negativeEpoch;
+}
+
+void Tial::VFS::LookupCache::clear() {
+	std::unique_lock<std::mutex> lock(mutex);
+	entries.clear();
+	negativeEntries.clear();
+	++_epoch;
+}
+
+size_t Tial::VFS::LookupCache::capacity() const {
+	std::unique_lock<std::mutex> lock(mutex);
+	return _capacity;
+}
+
+void Tial::VFS::LookupCache::setCapacity(size_t capacity) {
+	std::unique_lock<std::mutex> lock(mutex);
+	_capacity = capacity;
+	if(entries.size() > _capacity)
+		entries.clear();
+}
+
+size_t Tial::VFS::LookupCache::negativeCapacity() const {
+	std::unique_lock<std::mutex> lock(mutex);
+	return _negativeCapacity;
+}
+
+void Tial::VFS::LookupCache::setNegativeCapacity(size_t capacity) {
+	std::unique_lock<std::mutex> lock(mutex);
+	_negativeCapacity = capacity;
+	if(negativeEntries.size() > _negativeCapacity)
+		negativeEntries.clear();
+}
+
+Tial::VFS::LookupCache::Statistics Tial::VFS::LookupCache::statistics() const {
+	Statistics statistics;
+	statistics.hits = _hits;
+	statistics.negativeHits = _negativeHits;
+	statistics.misses = _misses;
+	return statistics;
+}
+
+void Tial::VFS::LookupCache::resetStatistics() {
+	_hits = 0;
+	_negativeHits = 0;
+	_misses = 0;
+}
@@ -2,6 +2,15 @@
 
 #include "Exception.hpp"
 
+#include <cstring>
+
+#include <boost/predef.h>
+
+#if BOOST_OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include <TialUtility/TialUtility.hpp>
 
 #define TIAL_MODULE "Tial::VFS::MemoryDriver"
@@ -10,33 +19,67 @@ Tial::VFS::MemoryDriver::Node::Node(bool directory): directory(directory) {
 	LOGN3;
 }
 
+Tial::VFS::MemoryDriver::Attributes Tial::VFS::MemoryDriver::Node::attributes(uint64_t device) const {
+	Attributes attributes(directory ? Attributes::Kind::Directory : Attributes::Kind::File);
+	attributes.size = data->size();
+	attributes.modificationTime = modificationTime;
+	attributes.identity = Attributes::Identity{device, reinterpret_cast<uintptr_t>(this)};
+	return attributes;
+}
+
+void Tial::VFS::MemoryDriver::Node::modified() {
+	modificationTime = std::chrono::system_clock::now();
+}
+
 Tial::VFS::MemoryDriver::FileEntry
-Tial::VFS::MemoryDriver::Node::get(const Path &path) {
+Tial::VFS::MemoryDriver::Node::get(const Path &path, uint64_t device) {
 	auto node = getNode(path);
-	return {path[path.size()-1], node->directory};
+	return FileEntry(path[path.size()-1], node->attributes(device));
 }
 
 std::shared_ptr<Tial::VFS::MemoryDriver::Node>
 Tial::VFS::MemoryDriver::Node::getNode(const Path &path) {
 	LOGN2 << "path = " << path;
+	auto node = findNode(path);
+	if(!node)
+		THROW Exceptions::ElementNotFound(path, Path());
+	return node;
+}
+
+std::shared_ptr<Tial::VFS::MemoryDriver::Node>
+Tial::VFS::MemoryDriver::Node::findNode(const Path &path) {
 	assert(!path.empty());
-	if(path.size() == 1)
-		return elements.at(path[0]);
-	return elements.at(path[0])->getNode(path.subpath(1));
+	auto node = this;
+	for(size_t i = 0;; ++i) {
+		auto it = node->elements.find(path[i]);
+		if(it == node->elements.end())
+			return nullptr;
+		if(i+1 == path.size())
+			return it->second;
+		node = it->second.get();
+	}
 }
 
-std::vector<Tial::VFS::MemoryDriver::FileEntry>
-Tial::VFS::MemoryDriver::Node::listDirectory(const Path &path) {
+void Tial::VFS::MemoryDriver::Node::listDirectory(const Path &path, Listing &listing, size_t limit,
+		const NamePattern &filter, uint64_t device) {
 	LOGN2 << "path = " << path;
-	if(path.empty()) {
-		std::vector<Tial::VFS::MemoryDriver::FileEntry> v;
-		for(auto &&i: elements) {
-			LOGN3 << "adding element " << i.first;
-			v.push_back({i.first, i.second->directory});
+	if(!path.empty())
+		return elements.at(path[0])->listDirectory(path.subpath(1), listing, limit, filter, device);
+
+	// elements have no stable order, resume token is the number of matching ones returned before
+	auto skip = listing.resumeToken();
+	Listing::ResumeToken matching = 0;
+	for(auto &&i: elements) {
+		if(!filter.matches(i.first) || matching++ < skip)
+			continue;
+		if(limit != 0 && listing.size() == limit) {
+			listing.suspend(skip+listing.size());
+			return;
 		}
-		return v;
+		LOGN3 << "adding element " << i.first;
+		listing.append(i.first.data(), i.first.size(), i.second->attributes(device));
 	}
-	return elements.at(path[0])->listDirectory(path.subpath(1));
+	listing.finish();
 }
 
 void Tial::VFS::MemoryDriver::Node::createNode(const Path &path, bool directory) {
@@ -46,6 +89,7 @@ void Tial::VFS::MemoryDriver::Node::createNode(const Path &path, bool directory)
 		if(elements.find(path[0]) != elements.end())
 			THROW Exceptions::ElementAlreadyExists(path);
 		elements.emplace(std::make_pair(path[0], std::make_shared<Node>(directory)));
+		modified();
 	}
 	else if(path.size() >= 2)
 		elements[path[0]]->createNode(path.subpath(1), directory);
@@ -55,19 +99,55 @@ void Tial::VFS::MemoryDriver::Node::createNode(const Path &path, bool directory)
 void Tial::VFS::MemoryDriver::Node::removeNode(const Path &path) {
 	LOGN3 << "Removing node " << path;
 	assert(!path.empty());
-	if(path.size() == 1)
+	if(path.size() == 1) {
 		elements.erase(path[0]);
+		modified();
+	}
 	else if(path.size() >= 2)
 		elements[path[0]]->removeNode(path.subpath(1));
 }
 
+std::vector<uint8_t> &Tial::VFS::MemoryDriver::Node::resizable(size_t size) {
+	// reallocation would free bytes lent to views, they keep the old buffer then
+	if(size > data->capacity() && data.use_count() > 1) {
+		LOGN3 << "Data is viewed, copying before it is reallocated";
+		auto copy = std::make_shared<std::vector<uint8_t>>();
+		copy->reserve(std::max(size, 2*data->capacity()));
+		copy->assign(data->begin(), data->end());
+		data = copy;
+	}
+	return *data;
+}
+
+void Tial::VFS::MemoryDriver::Node::advise(Advice advice, uintmax_t offset, uintmax_t length) {
+	LOGN3 << "offset = " << offset << ", length = " << length;
+#if BOOST_OS_LINUX && defined(MADV_HUGEPAGE)
+	if(advice != Advice::HugePage || offset >= data->size())
+		return;
+
+	// only whole pages within the buffer can be advised
+	uintptr_t pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+	uintptr_t begin = reinterpret_cast<uintptr_t>(data->data()) + offset;
+	uintptr_t end = reinterpret_cast<uintptr_t>(data->data()) + ((length == 0 || length > data->size()-offset)
+		? data->size() : offset+length);
+	begin = (begin + pageSize - 1) / pageSize * pageSize;
+	end = end / pageSize * pageSize;
+	if(begin < end && ::madvise(reinterpret_cast<void*>(begin), end-begin, MADV_HUGEPAGE) != 0)
+		LOGN2 << "Huge pages not available: " << errno;
+#else
+	(void)advice;
+#endif
+}
+
 Tial::VFS::MemoryDriver::MemoryOpenFile::MemoryOpenFile(
 	const std::shared_ptr<Node> &node): node(node) {}
 
 size_t Tial::VFS::MemoryDriver::MemoryOpenFile::read(size_t pos, void *buffer, size_t bufferSize) {
 	LOGN3 << "buffer = " << buffer << ", bufferSize = " << bufferSize;
-	size_t toRead = std::min(node->data.size() - pos, bufferSize);
-	auto inputStart = node->data.cbegin()+pos;
+	if(pos >= node->data->size())
+		return 0;
+	size_t toRead = std::min(node->data->size() - pos, bufferSize);
+	auto inputStart = node->data->cbegin()+pos;
 	auto inputEnd = inputStart+toRead;
 	auto outputStart = reinterpret_cast<uint8_t*>(buffer);
 	auto outputEnd = std::copy(inputStart, inputEnd, outputStart);
@@ -80,64 +160,155 @@ size_t Tial::VFS::MemoryDriver::MemoryOpenFile::write(size_t pos, const void *bu
 	LOGN3 << "buffer = " << buffer << ", bufferSize = " << bufferSize;
 	auto inputStart = reinterpret_cast<const uint8_t*>(buffer);
 	auto inputSize = bufferSize;
-	auto outputStart = node->data.begin()+pos;
-	auto outputSize = node->data.end()-outputStart;
+	auto &data = node->resizable(pos+bufferSize);
+	auto outputStart = data.begin()+pos;
+	auto outputSize = data.end()-outputStart;
 	assert(outputSize >= 0);
 
 	auto overwritePartSize = std::min(inputSize, static_cast<size_t>(outputSize));
 
 	std::copy(inputStart, inputStart+overwritePartSize, outputStart);
-	std::copy(inputStart+overwritePartSize, inputStart+inputSize, std::inserter(node->data, node->data.end()));
+	std::copy(inputStart+overwritePartSize, inputStart+inputSize, std::inserter(data, data.end()));
+	node->modified();
 	return bufferSize;
 }
 
+size_t Tial::VFS::MemoryDriver::MemoryOpenFile::readv(size_t pos, const std::vector<Buffer> &buffers) {
+	LOGN3 << "pos = " << pos << ", buffers = " << buffers.size();
+	auto &data = *node->data;
+	size_t total = 0;
+	for(const auto &buffer: buffers) {
+		if(pos+total >= data.size())
+			break;
+		size_t toRead = std::min(data.size() - (pos+total), buffer.size);
+		std::memcpy(buffer.data, data.data()+pos+total, toRead);
+		total += toRead;
+	}
+	return total;
+}
+
+size_t Tial::VFS::MemoryDriver::MemoryOpenFile::writev(size_t pos, const std::vector<ConstBuffer> &buffers) {
+	LOGN3 << "pos = " << pos << ", buffers = " << buffers.size();
+	size_t total = 0;
+	for(const auto &buffer: buffers)
+		total += buffer.size;
+
+	// grow once for the whole range, then copy pieces in place
+	auto &data = node->resizable(pos+total);
+	if(pos+total > data.size())
+		data.resize(pos+total);
+	size_t offset = pos;
+	for(const auto &buffer: buffers) {
+		if(buffer.size > 0)
+			std::memcpy(data.data()+offset, buffer.data, buffer.size);
+		offset += buffer.size;
+	}
+	node->modified();
+	return total;
+}
+
 size_t Tial::VFS::MemoryDriver::MemoryOpenFile::size() {
 	LOGN3;
-	return node->data.size();
+	return node->data->size();
+}
+
+void Tial::VFS::MemoryDriver::MemoryOpenFile::advise(Advice advice, uintmax_t offset, uintmax_t length) {
+	node->advise(advice, offset, length);
 }
 
 Tial::VFS::MemoryDriver::MemoryMappedFile::MemoryMappedFile(const std::weak_ptr<Node> &node): node(node) {}
 
 void *Tial::VFS::MemoryDriver::MemoryMappedFile::get() {
 	LOGN3 << "this = " << reinterpret_cast<void*>(this);
-	return reinterpret_cast<void*>(node.lock()->data.data());
+	return reinterpret_cast<void*>(node.lock()->data->data());
 }
 
 size_t Tial::VFS::MemoryDriver::MemoryMappedFile::size() {
-	return node.lock()->data.size();
+	return node.lock()->data->size();
 }
 
 void Tial::VFS::MemoryDriver::MemoryMappedFile::resize(size_t size) {
 	LOGN3 << "size = " << size;
-	node.lock()->data.resize(size);
+	auto n = node.lock();
+	n->resizable(size).resize(size);
+	n->modified();
+}
+
+size_t Tial::VFS::MemoryDriver::MemoryMappedFile::capacity() {
+	return node.lock()->data->capacity();
+}
+
+void Tial::VFS::MemoryDriver::MemoryMappedFile::advise(Advice advice, size_t offset, size_t length) {
+	node.lock()->advise(advice, offset, length);
+}
+
+void Tial::VFS::MemoryDriver::MemoryMappedFile::reserve(size_t capacity) {
+	LOGN3 << "capacity = " << capacity;
+	node.lock()->resizable(capacity).reserve(capacity);
 }
 
 Tial::VFS::MemoryDriver::MemoryDriver(const std::string &name): Driver(name) {}
 
+uint64_t Tial::VFS::MemoryDriver::device() const {
+	return reinterpret_cast<uintptr_t>(this);
+}
+
 Tial::VFS::MemoryDriver::FileEntry
 Tial::VFS::MemoryDriver::get(const Path &path) {
 	LOGN2 << "Getting file " << path;
 	assert(path.absolute());
-	return root->get(path.subpath(1));
+	return root->get(path.subpath(1), device());
+}
+
+boost::optional<Tial::VFS::MemoryDriver::FileEntry>
+Tial::VFS::MemoryDriver::tryGet(const Path &path) {
+	LOGN2 << "Looking for file " << path;
+	assert(path.absolute());
+	auto node = root->findNode(path.subpath(1));
+	if(!node)
+		return boost::none;
+	return FileEntry(path[path.size()-1], node->attributes(device()));
 }
 
 std::vector<Tial::VFS::MemoryDriver::FileEntry>
 Tial::VFS::MemoryDriver::listDirectory(const Path &path) {
-	LOGN2 << "Listing directory " << path;
+	return listDirectory(path, NamePattern());
+}
+
+std::vector<Tial::VFS::MemoryDriver::FileEntry>
+Tial::VFS::MemoryDriver::listDirectory(const Path &path, const NamePattern &filter) {
+	Listing listing;
+	listDirectory(path, listing, 0, filter);
+	std::vector<FileEntry> v;
+	v.reserve(listing.size());
+	for(size_t i = 0; i < listing.size(); ++i)
+		v.push_back(listing.entry(i));
+	return v;
+}
+
+void Tial::VFS::MemoryDriver::listDirectory(const Path &path, Listing &listing, size_t limit, const NamePattern &filter) {
+	LOGN2 << "Listing directory " << path << " with filter " << filter.text();
 	assert(path.absolute());
-	return root->listDirectory(path.subpath(1));
+	listing.clear();
+	if(listing.complete())
+		return;
+	root->listDirectory(path.subpath(1), listing, limit, filter, device());
 }
 
 uintmax_t Tial::VFS::MemoryDriver::size(const Path &path) {
 	LOGN2 << "path = " << path;
 	assert(path.absolute());
-	return root->getNode(path.subpath(1))->data.size();
+	return root->getNode(path.subpath(1))->data->size();
 }
 
 void Tial::VFS::MemoryDriver::resize(const Path &path, uintmax_t size) {
 	LOGN2 << "path = " << path << " size = " << size;
 	assert(path.absolute());
-	root->getNode(path.subpath(1))->data.resize(size);
+	auto node = root->getNode(path.subpath(1));
+	// buffer may move, nobody may use the mapping meanwhile
+	MappedFile::Exclusive exclusive(node->mapping);
+	node->resizable(size).resize(size);
+	node->modified();
 }
 
 void Tial::VFS::MemoryDriver::createFile(const Path &path) {
@@ -187,3 +358,95 @@ std::shared_ptr<Tial::VFS::Driver::MappedFile> Tial::VFS::MemoryDriver::map(cons
 		node->mapping.reset(new MemoryMappedFile(node));
 	return node->mapping;
 }
+
+Tial::VFS::Driver::ViewedRange Tial::VFS::MemoryDriver::view(const Path &path, uintmax_t offset, size_t length) {
+	LOGN2 << "Viewing file " << path << ", offset = " << offset << ", length = " << length;
+	assert(path.absolute());
+	auto node = root->getNode(path.subpath(1));
+	if(node->directory)
+		THROW Exceptions::ElementKindInvalid(path, "expected file");
+
+	// range keeps the buffer itself, node makes a copy of it before resizing
+	ViewedRange range;
+	auto data = node->data;
+	if(offset >= data->size())
+		return range;
+	range.size = std::min<size_t>(length, data->size()-offset);
+	range.data = data->data()+offset;
+	range.owner = data;
+	return range;
+}
+
+Tial::VFS::Task<Tial::VFS::Driver::FileEntry> Tial::VFS::MemoryDriver::getAsync(const Path &path,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		return get(path);
+	});
+}
+
+Tial::VFS::Task<std::vector<Tial::VFS::Driver::FileEntry>> Tial::VFS::MemoryDriver::listDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		return listDirectory(path);
+	});
+}
+
+Tial::VFS::Task<uintmax_t> Tial::VFS::MemoryDriver::sizeAsync(const Path &path, const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		return size(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::MemoryDriver::resizeAsync(const Path &path, uintmax_t size,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path, size]() {
+		resize(path, size);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::MemoryDriver::createFileAsync(const Path &path, const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		createFile(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::MemoryDriver::removeFileAsync(const Path &path, const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		removeFile(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::MemoryDriver::createDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		createDirectory(path);
+	});
+}
+
+Tial::VFS::Task<void> Tial::VFS::MemoryDriver::removeDirectoryAsync(const Path &path,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		removeDirectory(path);
+	});
+}
+
+Tial::VFS::Task<std::shared_ptr<Tial::VFS::Driver::OpenFile>> Tial::VFS::MemoryDriver::openAsync(const Path &path,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path]() {
+		return open(path);
+	});
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::MemoryDriver::readAsync(const Path &path, uintmax_t pos, const Buffer &buffer,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path, pos, &buffer]() {
+		return open(path)->read(pos, buffer.data, buffer.size);
+	});
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::MemoryDriver::writeAsync(const Path &path, uintmax_t pos, const ConstBuffer &buffer,
+		const std::shared_ptr<Executor> &) {
+	return completed([this, &path, pos, &buffer]() {
+		return open(path)->write(pos, buffer.data, buffer.size);
+	});
+}
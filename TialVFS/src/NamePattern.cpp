@@ -0,0 +1,131 @@
+#include "NamePattern.hpp"
+#include "DirectoryContent.hpp"
+
+#include <TialUtility/TialUtility.hpp>
+
+#define TIAL_MODULE "Tial::VFS::NamePattern"
+
+namespace {
+
+inline char fold(char c) {
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+// compares chunk with '?' placeholders against name starting at given position
+inline bool chunkAt(const std::string &chunk, const std::string &name, size_t position, bool caseSensitive,
+		bool placeholders = true) {
+	for(size_t i = 0; i < chunk.size(); ++i) {
+		char p = chunk[i], c = name[position+i];
+		if((placeholders && p == '?') || p == c)
+			continue;
+		if(caseSensitive || fold(p) != fold(c))
+			return false;
+	}
+	return true;
+}
+
+}
+
+Tial::VFS::NamePattern::NamePattern(const std::string &pattern, bool caseSensitive)
+		: _text(pattern), _caseSensitive(caseSensitive) {
+	if(pattern.find_first_of("[]{}\\") != std::string::npos) {
+		_kind = Kind::Pattern;
+		return;
+	}
+	if(pattern.find_first_of("*?") == std::string::npos) {
+		_kind = Kind::Literal;
+		return;
+	}
+
+	_kind = Kind::Wildcard;
+	anchoredStart = (pattern.front() != '*');
+	anchoredEnd = (pattern.back() != '*');
+	size_t begin = 0;
+	for(;;) {
+		size_t star = pattern.find('*', begin);
+		auto chunk = pattern.substr(begin, star == std::string::npos ? std::string::npos : star-begin);
+		if(!chunk.empty())
+			chunks.push_back(chunk);
+		if(star == std::string::npos)
+			break;
+		begin = star+1;
+	}
+	if(chunks.empty())
+		_kind = Kind::Any;
+}
+
+Tial::VFS::NamePattern Tial::VFS::NamePattern::prefix(const std::string &prefix, bool caseSensitive) {
+	NamePattern pattern;
+	pattern._kind = prefix.empty() ? Kind::Any : Kind::Prefix;
+	pattern._text = prefix;
+	pattern._caseSensitive = caseSensitive;
+	return pattern;
+}
+
+Tial::VFS::NamePattern::Kind Tial::VFS::NamePattern::kind() const {
+	return _kind;
+}
+
+const std::string &Tial::VFS::NamePattern::text() const {
+	return _text;
+}
+
+bool Tial::VFS::NamePattern::caseSensitive() const {
+	return _caseSensitive;
+}
+
+void Tial::VFS::NamePattern::setCaseSensitive(bool caseSensitive) {
+	_caseSensitive = caseSensitive;
+}
+
+bool Tial::VFS::NamePattern::matches(const std::string &name) const {
+	return matches(name, _caseSensitive);
+}
+
+bool Tial::VFS::NamePattern::matches(const std::string &name, bool caseSensitive) const {
+	switch(_kind) {
+	case Kind::Any:
+		return true;
+	case Kind::Literal:
+		return DirectoryContent::equal(_text, name, caseSensitive);
+	case Kind::Prefix:
+		return name.size() >= _text.size() && chunkAt(_text, name, 0, caseSensitive, false);
+	case Kind::Pattern:
+		return Utility::Wildcards::match(_text, name);
+	case Kind::Wildcard:
+		break;
+	}
+
+	if(anchoredStart && anchoredEnd && chunks.size() == 1)
+		return name.size() == chunks[0].size() && chunkAt(chunks[0], name, 0, caseSensitive);
+
+	size_t begin = 0, end = name.size();
+	size_t first = 0, last = chunks.size();
+	if(anchoredStart) {
+		const auto &chunk = chunks[first++];
+		if(chunk.size() > end || !chunkAt(chunk, name, 0, caseSensitive))
+			return false;
+		begin = chunk.size();
+	}
+	if(anchoredEnd) {
+		const auto &chunk = chunks[--last];
+		if(begin+chunk.size() > end || !chunkAt(chunk, name, end-chunk.size(), caseSensitive))
+			return false;
+		end -= chunk.size();
+	}
+
+	// leftmost occurrence of every chunk leaves most room for the following ones
+	for(size_t i = first; i < last; ++i) {
+		const auto &chunk = chunks[i];
+		bool found = false;
+		for(; begin+chunk.size() <= end; ++begin)
+			if(chunkAt(chunk, name, begin, caseSensitive)) {
+				found = true;
+				break;
+			}
+		if(!found)
+			return false;
+		begin += chunk.size();
+	}
+	return true;
+}
@@ -1,5 +1,10 @@
 #include "NativeFSDriver.hpp"
 #include "Exception.hpp"
+#include "ThreadPool.hpp"
+
+#include <climits>
+#include <cstring>
+#include <thread>
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 #include <dirent.h>
@@ -7,11 +12,477 @@
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
+#if BOOST_OS_LINUX
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
 #define TIAL_MODULE "Tial::VFS::NativeFSDriver"
 
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+namespace {
+
+typedef Tial::VFS::Driver::Attributes Attributes;
+
+Attributes::Kind kindOfMode(mode_t mode) {
+	if(S_ISREG(mode))
+		return Attributes::Kind::File;
+	if(S_ISDIR(mode))
+		return Attributes::Kind::Directory;
+	if(S_ISLNK(mode))
+		return Attributes::Kind::Symlink;
+	return Attributes::Kind::Other;
+}
+
+// open directory stream of a ReadDir listing suspended between pages
+struct DirectoryStream {
+	DIR *directory;
+	// read past the end of the previous page
+	bool pending = false;
+	std::string name;
+	Attributes attributes;
+
+	explicit DirectoryStream(DIR *directory): directory(directory) {}
+	DirectoryStream(const DirectoryStream&) = delete;
+	DirectoryStream &operator=(const DirectoryStream&) = delete;
+	~DirectoryStream() {
+		::closedir(directory);
+	}
+};
+
+Attributes::Kind kindOfDirent(unsigned char type) {
+	switch(type) {
+	case DT_REG: return Attributes::Kind::File;
+	case DT_DIR: return Attributes::Kind::Directory;
+	case DT_LNK: return Attributes::Kind::Symlink;
+	case DT_UNKNOWN: return Attributes::Kind::Unknown;
+	default: return Attributes::Kind::Other;
+	}
+}
+
+std::chrono::system_clock::time_point timePoint(int64_t seconds, int64_t nanoseconds) {
+	return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+		std::chrono::seconds(seconds) + std::chrono::nanoseconds(nanoseconds)
+	));
+}
+
+Attributes attributesOf(const struct ::stat &data) {
+	Attributes attributes(kindOfMode(data.st_mode));
+	attributes.size = static_cast<uintmax_t>(data.st_size);
+#if BOOST_OS_MACOS
+	attributes.modificationTime = timePoint(data.st_mtimespec.tv_sec, data.st_mtimespec.tv_nsec);
+#else
+	attributes.modificationTime = timePoint(data.st_mtim.tv_sec, data.st_mtim.tv_nsec);
+#endif
+	attributes.identity = Attributes::Identity{static_cast<uint64_t>(data.st_dev), static_cast<uint64_t>(data.st_ino)};
+	return attributes;
+}
+
+// fstatat-like, returns -1 and sets errno on failure
+int statAt(int directory, const char *name, Attributes &attributes) {
+#if BOOST_OS_LINUX && defined(STATX_TYPE)
+	// ask only for what is cached, so filesystems may skip the rest
+	struct ::statx extended;
+	if(::statx(directory, name, AT_STATX_SYNC_AS_STAT,
+			STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO, &extended) == 0) {
+		attributes = Attributes(kindOfMode(extended.stx_mode));
+		attributes.size = extended.stx_size;
+		attributes.modificationTime = timePoint(extended.stx_mtime.tv_sec, extended.stx_mtime.tv_nsec);
+		attributes.identity = Attributes::Identity{
+			static_cast<uint64_t>(makedev(extended.stx_dev_major, extended.stx_dev_minor)),
+			extended.stx_ino
+		};
+		return 0;
+	}
+	if(errno != ENOSYS)
+		return -1;
+#endif
+
+	struct ::stat data;
+	if(::fstatat(directory, name, &data, 0) != 0)
+		return -1;
+	attributes = attributesOf(data);
+	return 0;
+}
+
+// Transfers buffers with preadv/pwritev-like call, in chunks of at most IOV_MAX buffers.
+// Continues after short transfers, until a call transfers nothing (end of file).
+template<typename BufferType, typename Call>
+size_t vectored(int fd, size_t pos, const std::vector<BufferType> &buffers, Call call) {
+	std::vector<struct ::iovec> iov;
+	iov.reserve(std::min<size_t>(buffers.size(), IOV_MAX));
+	for(const auto &buffer: buffers)
+		if(buffer.size > 0)
+			iov.push_back(iovec{const_cast<void*>(static_cast<const void*>(buffer.data)), buffer.size});
+
+	size_t total = 0;
+	for(size_t first = 0; first < iov.size();) {
+		int count = static_cast<int>(std::min<size_t>(iov.size()-first, IOV_MAX));
+		ssize_t r = call(fd, iov.data()+first, count, static_cast<off_t>(pos+total));
+		if(r == -1) {
+			if(errno == EINTR)
+				continue;
+			THROW std::system_error(errno, std::system_category());
+		}
+		if(r == 0)
+			break;
+
+		// skip fully transferred buffers, shift the partially transferred one
+		total += static_cast<size_t>(r);
+		for(size_t left = static_cast<size_t>(r); left > 0;) {
+			if(left >= iov[first].iov_len) {
+				left -= iov[first].iov_len;
+				++first;
+			} else {
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base)+left;
+				iov[first].iov_len -= left;
+				left = 0;
+			}
+		}
+	}
+	return total;
+}
+
+#if BOOST_OS_LINUX && defined(IORING_FEAT_CQE_SKIP)
+// Minimal io_uring instance, driven by raw system calls, with a table of direct descriptors.
+class Ring {
+	int fd = -1;
+	void *rings = MAP_FAILED;
+	size_t ringsSize = 0;
+	io_uring_sqe *sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+	size_t sqesSize = 0;
+
+	unsigned *sqHead, *sqTail, sqMask, sqEntries, *sqArray;
+	unsigned *cqHead, *cqTail, cqMask;
+	io_uring_cqe *cqes;
+	unsigned tail = 0; // of submission queue, including entries not published yet
+
+	void release() {
+		if(sqes != MAP_FAILED)
+			::munmap(sqes, sqesSize);
+		if(rings != MAP_FAILED)
+			::munmap(rings, ringsSize);
+		if(fd != -1)
+			::close(fd);
+	}
+
+	template<typename T>
+	T *at(size_t offset) {
+		return reinterpret_cast<T*>(static_cast<char*>(rings)+offset);
+	}
+
+public:
+	// throws std::system_error if io_uring or any of used operations is not available
+	Ring(unsigned entries, unsigned files) {
+		try {
+			io_uring_params params;
+			std::memset(&params, 0, sizeof(params));
+			fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+			if(fd == -1)
+				THROW std::system_error(errno, std::system_category());
+			// direct descriptors of open and close came in 5.15, this is the closest feature flag
+			if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_CQE_SKIP))
+				THROW std::system_error(ENOSYS, std::system_category());
+
+			ringsSize = std::max<size_t>(params.sq_off.array + params.sq_entries*sizeof(unsigned),
+				params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe));
+			rings = ::mmap(nullptr, ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+				IORING_OFF_SQ_RING);
+			if(rings == MAP_FAILED)
+				THROW std::system_error(errno, std::system_category());
+			sqesSize = params.sq_entries*sizeof(io_uring_sqe);
+			sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+			if(sqes == MAP_FAILED)
+				THROW std::system_error(errno, std::system_category());
+
+			sqHead = at<unsigned>(params.sq_off.head);
+			sqTail = at<unsigned>(params.sq_off.tail);
+			sqMask = *at<unsigned>(params.sq_off.ring_mask);
+			sqEntries = params.sq_entries;
+			sqArray = at<unsigned>(params.sq_off.array);
+			cqHead = at<unsigned>(params.cq_off.head);
+			cqTail = at<unsigned>(params.cq_off.tail);
+			cqMask = *at<unsigned>(params.cq_off.ring_mask);
+			cqes = at<io_uring_cqe>(params.cq_off.cqes);
+			tail = *sqTail;
+
+			std::vector<char> probeData(sizeof(io_uring_probe) + 256*sizeof(io_uring_probe_op));
+			auto probe = reinterpret_cast<io_uring_probe*>(probeData.data());
+			if(::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == -1)
+				THROW std::system_error(errno, std::system_category());
+			for(int op: {IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE})
+				if(op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+					THROW std::system_error(ENOSYS, std::system_category());
+
+			// empty slots, filled by direct opens
+			std::vector<int> table(files, -1);
+			if(files > 0 && ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_FILES, table.data(), files) == -1)
+				THROW std::system_error(errno, std::system_category());
+		} catch(...) {
+			release();
+			throw;
+		}
+	}
+
+	Ring(const Ring &) = delete;
+	Ring &operator=(const Ring &) = delete;
+
+	~Ring() {
+		release();
+	}
+
+	// cleared entry to fill in, null if submission queue is full
+	io_uring_sqe *next() {
+		if(tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+			return nullptr;
+		auto sqe = &sqes[tail & sqMask];
+		std::memset(sqe, 0, sizeof(*sqe));
+		sqArray[tail & sqMask] = tail & sqMask;
+		++tail;
+		return sqe;
+	}
+
+	// submits all new entries and waits until at least wait completions are available
+	void submit(unsigned wait) {
+		__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+		unsigned count = tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		while(::syscall(__NR_io_uring_enter, fd, count, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0) == -1) {
+			if(errno != EINTR)
+				THROW std::system_error(errno, std::system_category());
+		}
+	}
+
+	// waits until at least count completions are available, without submitting anything
+	void wait(unsigned count) {
+		while(::syscall(__NR_io_uring_enter, fd, 0, count, IORING_ENTER_GETEVENTS, nullptr, 0) == -1) {
+			if(errno != EINTR)
+				THROW std::system_error(errno, std::system_category());
+		}
+	}
+
+	// calls function for every available completion, returns their number
+	template<typename Function>
+	unsigned reap(Function function) {
+		unsigned head = *cqHead, count = 0;
+		for(unsigned end = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE); head != end; ++head, ++count)
+			function(cqes[head & cqMask]);
+		__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		return count;
+	}
+};
+#endif
+
+size_t pageCeil(size_t size) {
+	static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+	return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+#if BOOST_OS_LINUX && defined(IORING_FEAT_CQE_SKIP)
+// Linux transfers at most this much in one read or write
+size_t transferLimit() {
+	return INT_MAX / pageCeil(1) * pageCeil(1);
+}
+
+// Reads and writes submitted from any thread, completed by a thread of the ring. That thread
+// keeps the ring alive until stop(), so the ring may outlive its driver.
+class AsyncRing: public std::enable_shared_from_this<AsyncRing> {
+public:
+	struct Operation {
+		std::shared_ptr<void> file; // keeps descriptor open
+		int fd;
+		bool write;
+		uintmax_t pos;
+		char *data;
+		size_t size;
+		size_t done;
+		Tial::VFS::Promise<size_t> promise;
+		std::shared_ptr<Tial::VFS::Executor> executor;
+	};
+
+private:
+	Ring ring;
+	std::mutex mutex; // of submission queue
+	std::thread thread;
+
+	// takes ownership of operation, whose result is set on its executor
+	static void finish(Operation *raw, int error) {
+		std::shared_ptr<Operation> operation(raw);
+		auto complete = [operation, error]() {
+			if(error != 0)
+				operation->promise.setException(std::make_exception_ptr(
+					std::system_error(error, std::system_category())));
+			else
+				operation->promise.setValue(operation->done);
+		};
+		try {
+			operation->executor->execute(complete);
+		} catch(...) {
+			complete();
+		}
+	}
+
+	void run() {
+		for(bool stopping = false; !stopping;) {
+			try {
+				ring.wait(1);
+			} catch(const std::system_error &e) {
+				LOGW << "Waiting for asynchronous transfers failed: " << e.what();
+				return;
+			}
+			ring.reap([this, &stopping](const io_uring_cqe &cqe) {
+				if(cqe.user_data == 0) {
+					stopping = true;
+					return;
+				}
+				auto operation = reinterpret_cast<Operation*>(cqe.user_data);
+				if(cqe.res == -EINTR || cqe.res == -EAGAIN) {
+					resubmit(operation);
+					return;
+				}
+				if(cqe.res < 0) {
+					finish(operation, -cqe.res);
+					return;
+				}
+				// reads stop early only at end of file, anything else short is continued
+				size_t requested = std::min(operation->size - operation->done, transferLimit());
+				operation->done += static_cast<size_t>(cqe.res);
+				if(cqe.res > 0 && operation->done < operation->size
+						&& (operation->write || static_cast<size_t>(cqe.res) == requested))
+					resubmit(operation);
+				else
+					finish(operation, 0);
+			});
+		}
+	}
+
+	void resubmit(Operation *operation) {
+		try {
+			submit(operation);
+		} catch(const std::system_error &e) {
+			finish(operation, e.code().value());
+		}
+	}
+
+public:
+	explicit AsyncRing(unsigned entries): ring(entries, 0) {}
+
+	void start() {
+		auto self = shared_from_this();
+		thread = std::thread([self]() {
+			self->run();
+		});
+	}
+
+	// completion thread ends once it gets to the request, unless it calls this itself
+	void stop() {
+		try {
+			std::unique_lock<std::mutex> lock(mutex);
+			auto nop = ring.next();
+			if(!nop)
+				THROW std::system_error(EBUSY, std::system_category());
+			nop->opcode = IORING_OP_NOP;
+			nop->user_data = 0;
+			ring.submit(0);
+		} catch(const std::system_error &e) {
+			LOGW << "Stopping asynchronous transfers failed: " << e.what();
+			thread.detach();
+			return;
+		}
+		if(thread.get_id() == std::this_thread::get_id())
+			thread.detach();
+		else
+			thread.join();
+	}
+
+	// operation stays owned by the ring if this returns normally
+	void submit(Operation *operation) {
+		std::unique_lock<std::mutex> lock(mutex);
+		auto sqe = ring.next();
+		if(!sqe)
+			THROW std::system_error(EBUSY, std::system_category());
+		sqe->opcode = operation->write ? IORING_OP_WRITE : IORING_OP_READ;
+		sqe->fd = operation->fd;
+		sqe->addr = reinterpret_cast<uint64_t>(operation->data + operation->done);
+		sqe->len = static_cast<uint32_t>(std::min(operation->size - operation->done, transferLimit()));
+		sqe->off = operation->pos + operation->done;
+		sqe->user_data = reinterpret_cast<uint64_t>(operation);
+		try {
+			ring.submit(0);
+		} catch(const std::system_error &e) {
+			// entry is published already and goes with the next submission
+			LOGW << "Submitting asynchronous transfer failed: " << e.what();
+		}
+	}
+};
+#endif
+
+void syncMemory(void *address, size_t length, bool async) {
+	// msync() takes whole pages
+	uintptr_t begin = reinterpret_cast<uintptr_t>(address) / pageCeil(1) * pageCeil(1);
+	uintptr_t end = reinterpret_cast<uintptr_t>(address) + length;
+	if(length > 0 && ::msync(reinterpret_cast<void*>(begin), end-begin, async ? MS_ASYNC : MS_SYNC) != 0)
+		THROW std::system_error(errno, std::system_category());
+}
+
+// advice not known to the platform is ignored
+void adviseMemory(void *address, size_t length, Tial::VFS::Driver::Advice advice) {
+	typedef Tial::VFS::Driver::Advice Advice;
+	int value = MADV_NORMAL;
+	switch(advice) {
+	case Advice::Normal:
+		value = MADV_NORMAL;
+		break;
+	case Advice::Sequential:
+		value = MADV_SEQUENTIAL;
+		break;
+	case Advice::Random:
+		value = MADV_RANDOM;
+		break;
+	case Advice::WillNeed:
+		value = MADV_WILLNEED;
+		break;
+	case Advice::DontNeed:
+		value = MADV_DONTNEED;
+		break;
+	case Advice::HugePage:
+#ifdef MADV_HUGEPAGE
+		value = MADV_HUGEPAGE;
+		break;
+#else
+		return;
+#endif
+	}
+
+	// advice applies to whole pages
+	uintptr_t begin = reinterpret_cast<uintptr_t>(address) / pageCeil(1) * pageCeil(1);
+	uintptr_t end = reinterpret_cast<uintptr_t>(address) + length;
+	if(length == 0 || ::madvise(reinterpret_cast<void*>(begin), end-begin, value) == 0)
+		return;
+	if(errno == EINVAL) {
+		LOGN2 << "Advice not supported for this mapping";
+		return;
+	}
+	THROW std::system_error(errno, std::system_category());
+}
+
+// descriptors of directories are only used as base of other operations
+#ifdef O_PATH
+const int directoryFlags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+#else
+const int directoryFlags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+#endif
+
+}
+#endif
+
 static Tial::Utility::NativePath toAbsolute(const Tial::Utility::NativePath &path) {
 	if(path.absolute())
 		return path;
@@ -19,10 +490,23 @@ static Tial::Utility::NativePath toAbsolute(const Tial::Utility::NativePath &pat
 }
 
 Tial::VFS::NativeFSDriver::NativeFSDriver(const Utility::NativePath &nativeDirectory, const std::string &name)
-		: Driver(_prepareName(name, nativeDirectory)), nativeDirectory(toAbsolute(nativeDirectory)) {
+		: Driver(_prepareName(name, nativeDirectory)), nativeDirectory(toAbsolute(nativeDirectory)),
+		directories(this->nativeDirectory, 256) {
+#if BOOST_OS_LINUX && defined(SYS_getdents64)
+	_scanner = Scanner::GetDents;
+#else
+	_scanner = Scanner::ReadDir;
+#endif
 	assert(this->nativeDirectory.absolute());
 }
 
+Tial::VFS::NativeFSDriver::~NativeFSDriver() {
+#if BOOST_OS_LINUX && defined(IORING_FEAT_CQE_SKIP)
+	if(asyncRing)
+		std::static_pointer_cast<AsyncRing>(asyncRing)->stop();
+#endif
+}
+
 std::string Tial::VFS::NativeFSDriver::_prepareName(
 	const std::string &name, const Utility::NativePath nativeDirectory
 ) {
@@ -31,11 +515,208 @@ std::string Tial::VFS::NativeFSDriver::_prepareName(
 	return "NativeFSDriver{nativePath = " + std::string(nativeDirectory) + "}";
 }
 
+Tial::VFS::NativeFSDriver::DirectoryDescriptors::Descriptor::Descriptor(int fd): fd(fd) {}
+
+Tial::VFS::NativeFSDriver::DirectoryDescriptors::Descriptor::~Descriptor() {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	if(::close(fd) == -1)
+		LOGW << "Closing directory descriptor " << fd << " failed: " << errno;
+#else
+#error "Platform not supported"
+#endif
+}
+
+int Tial::VFS::NativeFSDriver::DirectoryDescriptors::Descriptor::get() const {
+	return fd;
+}
+
+Tial::VFS::NativeFSDriver::DirectoryDescriptors::DirectoryDescriptors(
+	const Utility::NativePath &nativeDirectory, size_t capacity
+): nativeDirectory(nativeDirectory), _capacity(capacity) {}
+
+std::shared_ptr<Tial::VFS::NativeFSDriver::DirectoryDescriptors::Descriptor>
+Tial::VFS::NativeFSDriver::DirectoryDescriptors::get(const Path &path, bool &cached) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// mount root is opened once, on first use, and kept for the lifetime of the driver
+	if(!root) {
+		int fd = ::open(std::string(nativeDirectory).c_str(), directoryFlags);
+		if(fd == -1)
+			return nullptr;
+		LOGN2 << "Opened mount root " << nativeDirectory << " as " << fd;
+		root = std::make_shared<Descriptor>(fd);
+	}
+
+	// open relative to the deepest directory already cached
+	std::shared_ptr<Descriptor> base = root;
+	size_t depth = path.size();
+	for(; depth > 1; --depth) {
+		auto i = index.find(std::string(path.subpath(0, depth)));
+		if(i != index.end()) {
+			base = i->second->second;
+			entries.splice(entries.begin(), entries, i->second);
+			break;
+		}
+	}
+
+	// only descriptors from the cache may refer to something removed in the meantime
+	cached = (base != root);
+	if(depth == path.size()) {
+		++_statistics.hits;
+		return base;
+	}
+	++_statistics.misses;
+	lock.unlock();
+
+	std::string relative(path.subpath(depth));
+	int fd = ::openat(base->get(), relative.c_str(), directoryFlags);
+	if(fd == -1)
+		return nullptr;
+	auto result = std::make_shared<Descriptor>(fd);
+	LOGN3 << "Opened directory " << path << " as " << fd;
+
+	lock.lock();
+	std::string key(path);
+	auto i = index.find(key);
+	if(i != index.end()) {
+		// opened concurrently by someone else
+		entries.splice(entries.begin(), entries, i->second);
+		return i->second->second;
+	}
+	if(_capacity == 0)
+		return result;
+	entries.emplace_front(key, result);
+	index[key] = entries.begin();
+	evict();
+	return result;
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::DirectoryDescriptors::evict() {
+	while(entries.size() > _capacity) {
+		LOGN3 << "Evicting descriptor of " << entries.back().first;
+		index.erase(entries.back().first);
+		entries.pop_back();
+		++_statistics.evictions;
+	}
+}
+
+bool Tial::VFS::NativeFSDriver::DirectoryDescriptors::stale(const Path &path) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	std::unique_lock<std::mutex> lock(mutex);
+	if(!root)
+		return false;
+
+	// path is resolved from the deepest cached directory, once it is dropped the next one up
+	// is used, so checking continues until a current one is found
+	bool found = false;
+	Path gone;
+	for(size_t depth = path.size(); depth > 1; --depth) {
+		Path directory = path.subpath(0, depth);
+		std::string key(directory);
+		auto i = index.find(key);
+		if(i == index.end())
+			continue;
+
+		// removed directory has no links left, replaced one is not at its path anymore
+		struct stat cached, current;
+		bool stale = ::fstat(i->second->second->get(), &cached) == -1 || cached.st_nlink == 0
+			|| ::fstatat(root->get(), key.c_str()+1, &current, 0) == -1
+			|| cached.st_dev != current.st_dev || cached.st_ino != current.st_ino;
+		if(!stale)
+			break;
+
+		LOGN2 << "Cached descriptor of " << key << " is stale";
+		found = true;
+		gone = directory;
+	}
+	if(!found)
+		return false;
+
+	lock.unlock();
+	forget(gone);
+	return true;
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::DirectoryDescriptors::forget(const Path &path) {
+	std::unique_lock<std::mutex> lock(mutex);
+	std::string prefix(path);
+	for(auto i = entries.begin(); i != entries.end();) {
+		const std::string &key = i->first;
+		bool below = key.compare(0, prefix.size(), prefix) == 0
+			&& (key.size() == prefix.size() || key[prefix.size()] == '/' || prefix == "/");
+		if(below) {
+			index.erase(key);
+			i = entries.erase(i);
+		} else
+			++i;
+	}
+}
+
+void Tial::VFS::NativeFSDriver::DirectoryDescriptors::clear() {
+	std::unique_lock<std::mutex> lock(mutex);
+	LOGN2 << "Dropping " << entries.size() << " directory descriptors";
+	index.clear();
+	entries.clear();
+}
+
+size_t Tial::VFS::NativeFSDriver::DirectoryDescriptors::capacity() const {
+	std::unique_lock<std::mutex> lock(mutex);
+	return _capacity;
+}
+
+void Tial::VFS::NativeFSDriver::DirectoryDescriptors::setCapacity(size_t capacity) {
+	std::unique_lock<std::mutex> lock(mutex);
+	_capacity = capacity;
+	evict();
+}
+
+Tial::VFS::NativeFSDriver::DirectoryCacheStatistics Tial::VFS::NativeFSDriver::DirectoryDescriptors::statistics() const {
+	std::unique_lock<std::mutex> lock(mutex);
+	return _statistics;
+}
+
+int Tial::VFS::NativeFSDriver::at(const Path &path, const std::function<int(int, const char*)> &operation,
+		bool verified) {
+	// root of the mount is addressed as "." in itself
+	Path parent = (path.size() > 1) ? path.subpath(0, path.size()-1) : path;
+	const char *name = (path.size() > 1) ? path[path.size()-1].c_str() : ".";
+
+	for(bool retried = false;; retried = true) {
+		bool cached = false;
+		auto directory = directories.get(parent, cached);
+		// directory renamed behind the driver still accepts operations, so it is checked first
+		bool checked = directory && cached && verified && !retried;
+		if(checked && directories.stale(parent))
+			continue;
+		if(directory) {
+			if(operation(directory->get(), name) != -1)
+				return 0;
+		}
+		if(retried || !cached || checked || (errno != ENOENT && errno != ENOTDIR))
+			return -1;
+
+		// mostly the element is simply missing, retry only if cached directory is not current
+		int error = errno;
+		if(!directories.stale(parent)) {
+			errno = error;
+			return -1;
+		}
+		LOGN2 << "Retrying operation on " << path;
+	}
+}
+
 Tial::VFS::NativeFSDriver::NativeFileDescriptor::NativeFileDescriptor(
-	const std::shared_ptr<NativeFSDriver> &driver,
-	const Utility::NativePath &nativePath,
+	NativeFSDriver *driver,
+	const Path &path,
 	bool openAutomatically
-) : driver(driver), nativePath(nativePath) {
+) : driver(driver), path(path) {
 	if(openAutomatically)
 		descriptorOpen();
 }
@@ -50,9 +731,12 @@ void Tial::VFS::NativeFSDriver::NativeFileDescriptor::descriptorOpen() {
 	if(fd != -1)
 		THROW Exceptions::AlreadyOpened();
 
-	fd = ::open(std::string(nativePath).c_str(), O_RDWR);
-	if(fd == -1)
+	int result = -1;
+	if(driver->at(path, [&result](int directory, const char *name) {
+		return result = ::openat(directory, name, O_RDWR | O_CLOEXEC);
+	}, true) == -1)
 		THROW std::system_error(errno, std::system_category());
+	fd = result;
 #else
 #error "Platform not supported"
 #endif
@@ -70,6 +754,23 @@ void Tial::VFS::NativeFSDriver::NativeFileDescriptor::descriptorClose() {
 #endif
 }
 
+void Tial::VFS::NativeFSDriver::NativeFileDescriptor::descriptorReused() {}
+
+bool Tial::VFS::NativeFSDriver::NativeFileDescriptor::current() const {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	struct ::stat opened, named;
+	if(::fstat(fd, &opened) != 0)
+		return false;
+	if(driver->at(path, [&named](int directory, const char *name) {
+		return ::fstatat(directory, name, &named, 0);
+	}, true) == -1)
+		return false;
+	return opened.st_dev == named.st_dev && opened.st_ino == named.st_ino;
+#else
+#error "Platform not supported"
+#endif
+}
+
 size_t Tial::VFS::NativeFSDriver::NativeFileDescriptor::size() const {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 	assert(fd);
@@ -82,14 +783,90 @@ size_t Tial::VFS::NativeFSDriver::NativeFileDescriptor::size() const {
 #endif
 }
 
-void Tial::VFS::NativeFSDriver::cleanupOpenDescriptors() {
-	LOGN3;
+std::shared_ptr<Tial::VFS::NativeFSDriver::NativeFileDescriptor> Tial::VFS::NativeFSDriver::acquire(
+	size_t kind, const Path &path, const std::function<std::shared_ptr<NativeFileDescriptor>()> &create
+) {
 	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
-	for(auto i = openDescriptors.begin(); i != openDescriptors.end();) {
-		if(i->second.expired())
-			i = openDescriptors.erase(i);
-		else
-			++i;
+	std::string key(path);
+
+	auto i = openDescriptors[kind].find(key);
+	if(i != openDescriptors[kind].end()) {
+		if(auto user = i->second.user.lock()) {
+			LOGN1 << "Found existing descriptor";
+			++_descriptorCacheStatistics.hits;
+			return user;
+		}
+		if(i->second.idle) {
+			idleDescriptors.erase(i->second.position);
+			i->second.idle = false;
+		}
+		if(i->second.descriptor->current()) {
+			LOGN1 << "Reusing idle descriptor";
+			i->second.descriptor->descriptorReused();
+			++_descriptorCacheStatistics.hits;
+		} else {
+			LOGN1 << "Dropping idle descriptor of file replaced behind the driver";
+			openDescriptors[kind].erase(i);
+			i = openDescriptors[kind].end();
+		}
+	}
+	if(i == openDescriptors[kind].end()) {
+		auto descriptor = create();
+		i = openDescriptors[kind].emplace(key, OpenDescriptor()).first;
+		i->second.descriptor = descriptor;
+		++_descriptorCacheStatistics.misses;
+	}
+
+	// users share one pointer, the last one returns descriptor to the idle list; deleter lives
+	// as long as the weak pointer below, so it lets go of the driver once called
+	auto self = std::dynamic_pointer_cast<NativeFSDriver>(shared_from_this());
+	auto descriptor = i->second.descriptor;
+	std::shared_ptr<NativeFileDescriptor> result(descriptor.get(),
+			[self, kind, key, descriptor](NativeFileDescriptor*) mutable {
+		self->release(kind, key, descriptor);
+		descriptor.reset();
+		self.reset();
+	});
+	i->second.user = result;
+	return result;
+}
+
+void Tial::VFS::NativeFSDriver::release(
+	size_t kind, const std::string &path, const std::shared_ptr<NativeFileDescriptor> &descriptor
+) {
+	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+	auto i = openDescriptors[kind].find(path);
+	// forgotten, or acquired again while the previous user was going away
+	if(i == openDescriptors[kind].end() || i->second.descriptor != descriptor || !i->second.user.expired())
+		return;
+
+	LOGN3 << "Descriptor of " << path << " is idle";
+	idleDescriptors.emplace_front(kind, path);
+	i->second.idle = true;
+	i->second.position = idleDescriptors.begin();
+	evictDescriptors();
+}
+
+void Tial::VFS::NativeFSDriver::evictDescriptors() {
+	while(idleDescriptors.size() > _descriptorCacheCapacity) {
+		auto &last = idleDescriptors.back();
+		LOGN3 << "Evicting descriptor of " << last.second;
+		openDescriptors[last.first].erase(last.second);
+		idleDescriptors.pop_back();
+		++_descriptorCacheStatistics.evictions;
+	}
+}
+
+void Tial::VFS::NativeFSDriver::forgetDescriptors(const Path &path) {
+	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+	std::string key(path);
+	for(auto &descriptors: openDescriptors) {
+		auto i = descriptors.find(key);
+		if(i == descriptors.end())
+			continue;
+		if(i->second.idle)
+			idleDescriptors.erase(i->second.position);
+		descriptors.erase(i);
 	}
 }
 
@@ -98,7 +875,9 @@ uintmax_t Tial::VFS::NativeFSDriver::sizeNative(const Path &path) {
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 	struct ::stat data;
-	if(::stat(std::string(path).c_str(), &data) != 0)
+	if(at(path, [&data](int directory, const char *name) {
+		return ::fstatat(directory, name, &data, 0);
+	}) == -1)
 		THROW std::system_error(errno, std::system_category());
 	return data.st_size;
 #else
@@ -106,68 +885,131 @@ uintmax_t Tial::VFS::NativeFSDriver::sizeNative(const Path &path) {
 #endif
 }
 
-void Tial::VFS::NativeFSDriver::resizeNative(const Utility::NativePath &path, uintmax_t size) {
-	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+void Tial::VFS::NativeFSDriver::resizeNative(const Path &path, uintmax_t size) {
 	LOGN1 << "path = " << path << ", size = " << size;
-	assert(path.absolute());
 
-	cleanupOpenDescriptors();
+	// mapping of the file moves, so it is locked like a writable Mapping; not while holding
+	// descriptors, Mappings released meanwhile need them
+	auto mapped = [this, &path]() {
+		std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+		auto mapping = openDescriptors[NativeMappedFile::kind].find(std::string(path));
+		return (mapping != openDescriptors[NativeMappedFile::kind].end())
+			? std::shared_ptr<MappedFile>(std::static_pointer_cast<NativeMappedFile>(mapping->second.descriptor))
+			: nullptr;
+	};
+	auto mapping = mapped();
+	std::unique_ptr<MappedFile::Exclusive> exclusive(new MappedFile::Exclusive(mapping));
+	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+	for(auto current = mapped(); current != mapping; current = mapped()) {
+		// mapped by someone else in the meantime
+		lock.unlock();
+		exclusive.reset();
+		mapping = current;
+		exclusive.reset(new MappedFile::Exclusive(mapping));
+		lock.lock();
+	}
 
-	auto descriptors = openDescriptors.equal_range(path);
-	for(auto i = descriptors.first; i != descriptors.second; ++i)
-		i->second.lock()->descriptorClose();
+	// mapped views are not shrunk under their users
+	std::shared_ptr<NativeOpenFile> viewed;
+	auto open = openDescriptors[NativeOpenFile::kind].find(std::string(path));
+	if(open != openDescriptors[NativeOpenFile::kind].end())
+		viewed = std::static_pointer_cast<NativeOpenFile>(open->second.descriptor);
+	std::unique_lock<std::mutex> views;
+	if(viewed) {
+		views = std::unique_lock<std::mutex>(viewed->viewsMutex);
+		if(!viewed->viewEnds.empty() && size < *viewed->viewEnds.rbegin())
+			THROW Exceptions::FileViewed(path);
+	}
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	if(::truncate(std::string(path).c_str(), size) != 0)
+	// there is no truncateat()
+	int fd = -1;
+	if(at(path, [&fd](int directory, const char *name) {
+		return fd = ::openat(directory, name, O_WRONLY | O_CLOEXEC);
+	}, true) == -1)
 		THROW std::system_error(errno, std::system_category());
+	int result = ::ftruncate(fd, size);
+	int error = errno;
+	::close(fd);
+	if(result != 0)
+		THROW std::system_error(error, std::system_category());
 #else
 #error "Platform not supported"
 #endif
 
-	for(auto i = descriptors.first; i != descriptors.second; ++i)
-		i->second.lock()->descriptorOpen();
+	// mapping follows new size
+	if(mapping)
+		std::static_pointer_cast<NativeMappedFile>(mapping)->remap(size);
 }
 
 Tial::VFS::NativeFSDriver::NativeOpenFile::NativeOpenFile(
-	const std::shared_ptr<NativeFSDriver> &driver,
-	const Utility::NativePath &nativePath
-) : NativeFileDescriptor(driver, nativePath) {}
+	NativeFSDriver *driver,
+	const Path &path
+) : NativeFileDescriptor(driver, path) {}
 
-void Tial::VFS::NativeFSDriver::NativeOpenFile::seek(size_t pos) {
+Tial::VFS::NativeFSDriver::NativeOpenFile::~NativeOpenFile() {}
+
+size_t Tial::VFS::NativeFSDriver::NativeOpenFile::read(size_t pos, void *buffer, size_t bufferSize) {
+	LOGN3;
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	assert(fd);
-	if(::lseek(fd, pos, SEEK_SET) == -1)
-		THROW std::system_error(errno, std::system_category());
+	// a single call may transfer less than asked, e.g. 2 GB at most on Linux
+	size_t total = 0;
+	while(total < bufferSize) {
+		ssize_t r = ::pread(fd, static_cast<char*>(buffer)+total, bufferSize-total, static_cast<off_t>(pos+total));
+		if(r == -1) {
+			if(errno == EINTR)
+				continue;
+			THROW std::system_error(errno, std::system_category());
+		}
+		if(r == 0)
+			break;
+		total += static_cast<size_t>(r);
+	}
+	return total;
 #else
 #error "Platform not supported"
 #endif
 }
 
-Tial::VFS::NativeFSDriver::NativeOpenFile::~NativeOpenFile() {}
-
-size_t Tial::VFS::NativeFSDriver::NativeOpenFile::read(size_t pos, void *buffer, size_t bufferSize) {
+size_t Tial::VFS::NativeFSDriver::NativeOpenFile::write(size_t pos, const void *buffer, size_t bufferSize) {
 	LOGN3;
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	seek(pos);
-	ssize_t r = ::read(fd, buffer, bufferSize);
-	if(r == -1)
-		THROW std::system_error(errno, std::system_category());
-	assert(r >= 0);
-	return static_cast<size_t>(r);
+	// a single call may transfer less than asked, e.g. 2 GB at most on Linux
+	size_t total = 0;
+	while(total < bufferSize) {
+		ssize_t r = ::pwrite(fd, static_cast<const char*>(buffer)+total, bufferSize-total, static_cast<off_t>(pos+total));
+		if(r == -1) {
+			if(errno == EINTR)
+				continue;
+			THROW std::system_error(errno, std::system_category());
+		}
+		if(r == 0)
+			break;
+		total += static_cast<size_t>(r);
+	}
+	return total;
 #else
 #error "Platform not supported"
 #endif
 }
 
-size_t Tial::VFS::NativeFSDriver::NativeOpenFile::write(size_t pos, const void *buffer, size_t bufferSize) {
-	LOGN3;
+size_t Tial::VFS::NativeFSDriver::NativeOpenFile::readv(size_t pos, const std::vector<Buffer> &buffers) {
+	LOGN3 << "pos = " << pos << ", buffers = " << buffers.size();
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	seek(pos);
-	ssize_t r = ::write(fd, buffer, bufferSize);
-	if(r == -1)
-		THROW std::system_error(errno, std::system_category());
-	assert(r >= 0);
-	return static_cast<size_t>(r);
+	return vectored(fd, pos, buffers, [](int fd, const struct ::iovec *iov, int count, off_t offset) {
+		return ::preadv(fd, iov, count, offset);
+	});
+#else
+#error "Platform not supported"
+#endif
+}
+
+size_t Tial::VFS::NativeFSDriver::NativeOpenFile::writev(size_t pos, const std::vector<ConstBuffer> &buffers) {
+	LOGN3 << "pos = " << pos << ", buffers = " << buffers.size();
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	return vectored(fd, pos, buffers, [](int fd, const struct ::iovec *iov, int count, off_t offset) {
+		return ::pwritev(fd, iov, count, offset);
+	});
 #else
 #error "Platform not supported"
 #endif
@@ -177,11 +1019,64 @@ size_t Tial::VFS::NativeFSDriver::NativeOpenFile::size() {
 	return NativeFileDescriptor::size();
 }
 
+void Tial::VFS::NativeFSDriver::NativeOpenFile::advise(Advice advice, uintmax_t offset, uintmax_t length) {
+	LOGN3 << "offset = " << offset << ", length = " << length;
+#if BOOST_OS_LINUX
+	int value = POSIX_FADV_NORMAL;
+	switch(advice) {
+	case Advice::Normal:
+		value = POSIX_FADV_NORMAL;
+		break;
+	case Advice::Sequential:
+		value = POSIX_FADV_SEQUENTIAL;
+		break;
+	case Advice::Random:
+		value = POSIX_FADV_RANDOM;
+		break;
+	case Advice::WillNeed:
+		value = POSIX_FADV_WILLNEED;
+		break;
+	case Advice::DontNeed:
+		value = POSIX_FADV_DONTNEED;
+		break;
+	case Advice::HugePage:
+		return;
+	}
+	// returns error instead of setting errno
+	int error = ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), value);
+	if(error != 0)
+		THROW std::system_error(error, std::system_category());
+#elif (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	(void)advice;
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::NativeOpenFile::sync() {
+	LOGN2;
+#if BOOST_OS_LINUX
+	int result;
+	do {
+		result = ::fdatasync(fd);
+	} while(result == -1 && errno == EINTR);
+#elif (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	int result;
+	do {
+		result = ::fsync(fd);
+	} while(result == -1 && errno == EINTR);
+#else
+#error "Platform not supported"
+#endif
+	if(result != 0)
+		THROW std::system_error(errno, std::system_category());
+}
+
 
 Tial::VFS::NativeFSDriver::NativeMappedFile::NativeMappedFile(
-	const std::shared_ptr<NativeFSDriver> &driver,
-	const Utility::NativePath &nativePath
-) : NativeFileDescriptor(driver, nativePath, false) {
+	NativeFSDriver *driver,
+	const Path &path
+) : NativeFileDescriptor(driver, path, false) {
 	descriptorOpen();
 }
 
@@ -197,16 +1092,8 @@ void Tial::VFS::NativeFSDriver::NativeMappedFile::descriptorOpen() {
 	assert(_ptr == nullptr);
 	assert(_size == 0);
 
-	_size = size();
+	remap(NativeFileDescriptor::size());
 	LOGN3 << "this->_size = " << _size;
-
-	if(_size > 0) {
-		_ptr = ::mmap(0, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-		if(_ptr == MAP_FAILED) {
-			_ptr = nullptr;
-			THROW std::system_error(errno, std::system_category());
-		}
-	}
 #else
 #error "Platform not supported"
 #endif
@@ -217,10 +1104,11 @@ void Tial::VFS::NativeFSDriver::NativeMappedFile::descriptorClose() {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
 	int result = 0;
 	if(_ptr)
-		result = ::munmap(_ptr, _size);
+		result = ::munmap(_ptr, (_capacity > 0) ? _capacity : _size);
 
 	_ptr = nullptr;
 	_size = 0;
+	_capacity = 0;
 
 	if(result != 0)
 		THROW std::system_error(errno, std::system_category());
@@ -240,10 +1128,74 @@ void *Tial::VFS::NativeFSDriver::NativeMappedFile::get() {
 #endif
 }
 
+void Tial::VFS::NativeFSDriver::NativeMappedFile::descriptorReused() {
+	LOGN3;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	size_t size = NativeFileDescriptor::size();
+	if(size != _size)
+		remap(size);
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::NativeMappedFile::remap(size_t size) {
+	LOGN3 << "this->_size = " << _size << ", size = " << size;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	if(_capacity > 0 && size <= _capacity) {
+		// only pages at the end are mapped or given back to the reservation, rest stays in place
+		size_t mapped = pageCeil(_size), needed = pageCeil(size);
+		void *result = nullptr;
+		if(needed > mapped)
+			result = ::mmap(static_cast<char*>(_ptr)+mapped, needed-mapped, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_FIXED, fd, static_cast<off_t>(mapped));
+		else if(needed < mapped)
+			result = ::mmap(static_cast<char*>(_ptr)+needed, mapped-needed, PROT_NONE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+		if(result == MAP_FAILED)
+			THROW std::system_error(errno, std::system_category());
+		_size = size;
+		return;
+	}
+
+	if(_capacity > 0) {
+		// grown out of reservation, a twice larger one is made elsewhere
+		reserve(std::max(size, 2*_capacity));
+		remap(size);
+		return;
+	}
+
+#if BOOST_OS_LINUX
+	if(_ptr && size > 0) {
+		void *result = ::mremap(_ptr, _size, size, MREMAP_MAYMOVE);
+		if(result == MAP_FAILED)
+			THROW std::system_error(errno, std::system_category());
+		_ptr = result;
+		_size = size;
+		return;
+	}
+#endif
+
+	if(_ptr && ::munmap(_ptr, _size) != 0)
+		THROW std::system_error(errno, std::system_category());
+	_ptr = nullptr;
+	_size = 0;
+	if(size > 0) {
+		void *result = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(result == MAP_FAILED)
+			THROW std::system_error(errno, std::system_category());
+		_ptr = result;
+		_size = size;
+	}
+#else
+#error "Platform not supported"
+#endif
+}
+
 size_t Tial::VFS::NativeFSDriver::NativeMappedFile::size() {
 	LOGN3;
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	return driver->sizeNative(nativePath);
+	return _size;
 #else
 #error "Platform not supported"
 #endif
@@ -252,76 +1204,437 @@ size_t Tial::VFS::NativeFSDriver::NativeMappedFile::size() {
 void Tial::VFS::NativeFSDriver::NativeMappedFile::resize(size_t size) {
 	LOGN1 << "size = " << size;
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	driver->resizeNative(nativePath, size);
+	std::unique_lock<std::recursive_mutex> lock(driver->openDescriptorsMutex);
+	if(::ftruncate(fd, static_cast<off_t>(size)) != 0)
+		THROW std::system_error(errno, std::system_category());
+	remap(size);
 #else
 #error "Platform not supported"
 #endif
 }
 
-Tial::VFS::NativeFSDriver::FileEntry Tial::VFS::NativeFSDriver::get(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
+void Tial::VFS::NativeFSDriver::NativeMappedFile::advise(Advice advice, size_t offset, size_t length) {
+	LOGN2 << "offset = " << offset << ", length = " << length;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	if(offset >= _size)
+		return;
+	if(length == 0 || length > _size-offset)
+		length = _size-offset;
+	adviseMemory(static_cast<char*>(_ptr)+offset, length, advice);
+#else
+#error "Platform not supported"
+#endif
+}
 
+void Tial::VFS::NativeFSDriver::NativeMappedFile::populate() {
+	LOGN2;
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	struct ::stat data;
-	if(::stat(std::string(realPath).c_str(), &data) != 0)
+	if(_size == 0)
+		return;
+#ifdef MADV_POPULATE_READ
+	// faults pages in without touching the mapping itself, kernels before 5.14 reject it
+	if(::madvise(_ptr, _size, MADV_POPULATE_READ) == 0)
+		return;
+	if(errno != EINVAL)
 		THROW std::system_error(errno, std::system_category());
+#endif
+	adviseMemory(_ptr, _size, Advice::WillNeed);
+#else
+#error "Platform not supported"
+#endif
+}
 
-	bool directory = ((data.st_mode & S_IFDIR) == S_IFDIR);
-	return {realPath[realPath.size()-1], directory};
+void Tial::VFS::NativeFSDriver::NativeMappedFile::flush(size_t offset, size_t length, bool async) {
+	LOGN2 << "offset = " << offset << ", length = " << length << ", async = " << async;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	if(offset >= _size)
+		return;
+	if(length == 0 || length > _size-offset)
+		length = _size-offset;
+	syncMemory(static_cast<char*>(_ptr)+offset, length, async);
+#else
+#error "Platform not supported"
+#endif
+}
+
+size_t Tial::VFS::NativeFSDriver::NativeMappedFile::capacity() {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	return (_capacity > 0) ? _capacity : _size;
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::NativeMappedFile::reserve(size_t capacity) {
+	LOGN1 << "capacity = " << capacity;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	capacity = pageCeil(std::max<size_t>(capacity, _size));
+	if(capacity <= _capacity)
+		return;
+
+	void *range = ::mmap(0, capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(range == MAP_FAILED)
+		THROW std::system_error(errno, std::system_category());
+	if(_size > 0 && ::mmap(range, _size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+		int error = errno;
+		::munmap(range, capacity);
+		THROW std::system_error(error, std::system_category());
+	}
+
+	if(_ptr)
+		::munmap(_ptr, (_capacity > 0) ? _capacity : _size);
+	_ptr = range;
+	_capacity = capacity;
+#else
+#error "Platform not supported"
+#endif
+}
+
+Tial::VFS::NativeFSDriver::NativeMappedWindow::NativeMappedWindow(
+	const std::shared_ptr<NativeOpenFile> &file, uintmax_t offset, size_t length, bool writable, bool populate
+) : file(file), writable(writable), populate(populate), _length(length) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	mapped = pageCeil(std::max<size_t>(length, 1)) + pageCeil(1);
+	move(offset);
+#else
+#error "Platform not supported"
+#endif
+}
+
+Tial::VFS::NativeFSDriver::NativeMappedWindow::~NativeMappedWindow() {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	if(base && ::munmap(base, mapped) != 0)
+		LOGW << "Unmapping window failed: " << errno;
+#else
+#error "Platform not supported"
+#endif
+}
+
+void *Tial::VFS::NativeFSDriver::NativeMappedWindow::get() {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	return static_cast<char*>(base) + (_offset - _offset / pageCeil(1) * pageCeil(1));
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::NativeMappedWindow::advise(Advice advice) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	adviseMemory(get(), _length, advice);
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::NativeMappedWindow::flush(bool async) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	if(writable)
+		syncMemory(get(), size(), async);
+#else
+#error "Platform not supported"
+#endif
+}
+
+uintmax_t Tial::VFS::NativeFSDriver::NativeMappedWindow::offset() {
+	return _offset;
+}
+
+size_t Tial::VFS::NativeFSDriver::NativeMappedWindow::length() {
+	return _length;
+}
+
+size_t Tial::VFS::NativeFSDriver::NativeMappedWindow::size() {
+	uintmax_t size = file->size();
+	return (size > _offset) ? static_cast<size_t>(std::min<uintmax_t>(size-_offset, _length)) : 0;
+}
+
+void Tial::VFS::NativeFSDriver::NativeMappedWindow::move(uintmax_t offset) {
+	LOGN3 << "offset = " << offset;
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	uintmax_t start = offset / pageCeil(1) * pageCeil(1);
+	if(base && start == _offset / pageCeil(1) * pageCeil(1)) {
+		_offset = offset;
+		return;
+	}
+
+	// pages past end of file are mapped as well, they become usable once the file grows
+	int protection = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+	int flags = MAP_SHARED | (base ? MAP_FIXED : 0);
+#ifdef MAP_POPULATE
+	if(populate)
+		flags |= MAP_POPULATE;
+#endif
+	void *result = ::mmap(base, mapped, protection, flags, file->fd, static_cast<off_t>(start));
+	if(result == MAP_FAILED)
+		THROW std::system_error(errno, std::system_category());
+	base = result;
+	_offset = offset;
+#else
+#error "Platform not supported"
+#endif
+}
+
+Tial::VFS::NativeFSDriver::FileEntry Tial::VFS::NativeFSDriver::get(const Path &path) {
+	auto entry = tryGet(path);
+	if(!entry)
+		THROW Exceptions::ElementNotFound(path, Path());
+	return *entry;
+}
+
+boost::optional<Tial::VFS::NativeFSDriver::FileEntry> Tial::VFS::NativeFSDriver::tryGet(const Path &path) {
+	LOGN1 << "path = " << path;
+
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	Attributes attributes;
+	if(at(path, [&attributes](int directory, const char *name) {
+		return statAt(directory, name, attributes);
+	}) == -1) {
+		if(errno == ENOENT || errno == ENOTDIR)
+			return boost::none;
+		THROW std::system_error(errno, std::system_category());
+	}
+	auto name = (path.size() > 1) ? path[path.size()-1] : nativeDirectory[nativeDirectory.size()-1];
+	return FileEntry(name, attributes);
 #else
 #error "Platform not supported"
 #endif
 }
 
 std::vector<Tial::VFS::NativeFSDriver::FileEntry> Tial::VFS::NativeFSDriver::listDirectory(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
+	return listDirectory(path, NamePattern());
+}
 
+std::vector<Tial::VFS::NativeFSDriver::FileEntry> Tial::VFS::NativeFSDriver::listDirectory(const Path &path, const NamePattern &filter) {
+	Listing listing;
+	listDirectory(path, listing, 0, filter);
 	std::vector<Tial::VFS::NativeFSDriver::FileEntry> v;
+	v.reserve(listing.size());
+	for(size_t i = 0; i < listing.size(); ++i)
+		v.push_back(listing.entry(i));
+	return v;
+}
+
+void Tial::VFS::NativeFSDriver::listDirectory(const Path &path, Listing &listing, size_t limit, const NamePattern &filter) {
+	LOGN1 << "path = " << path << ", filter = " << filter.text()
+			<< ", limit = " << limit << ", resume token = " << listing.resumeToken();
+
+	listing.clear();
+	if(listing.complete())
+		return;
+
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	// directory stream suspended by the previous page is still open
+	if(listing.cursor()) {
+		readDirectory(-1, listing, limit, filter);
+		return;
+	}
 
+	// directory stream needs a descriptor of its own, cached ones may not be readable
+	int fd = -1;
+	if(at(path, [&fd](int directory, const char *name) {
+		return fd = ::openat(directory, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	}) == -1)
+		THROW std::system_error(errno, std::system_category());
+
+	if(_scanner == Scanner::GetDents)
+		scanDirectory(fd, listing, limit, filter);
+	else
+		readDirectory(fd, listing, limit, filter);
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::readDirectory(int fd, Listing &listing, size_t limit, const NamePattern &filter) {
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	std::unique_ptr<DIR, std::function<void(DIR*)>> realDirectory(
-		::opendir(std::string(realPath).c_str()),
-		[](DIR *ptr) {
-			::closedir(ptr);
+	// positions from telldir() are valid only in the stream they come from, so the stream
+	// itself is kept between pages, with the entry read past the end of the last one
+	std::shared_ptr<DirectoryStream> stream = std::static_pointer_cast<DirectoryStream>(listing.cursor());
+	if(!stream) {
+		if(listing.resumeToken() != 0) {
+			::close(fd);
+			THROW Exception("Listing suspended by another scanner cannot be resumed");
+		}
+		DIR *directory = ::fdopendir(fd);
+		if(!directory) {
+			int error = errno;
+			::close(fd);
+			THROW std::system_error(error, std::system_category());
 		}
-	);
-	if(!realDirectory)
+		stream = std::make_shared<DirectoryStream>(directory);
+	}
+	fd = ::dirfd(stream->directory);
+
+	// entries carry kind and inode, device is the same for all of them
+	struct ::stat directoryData;
+	if(::fstat(fd, &directoryData) != 0)
 		THROW std::system_error(errno, std::system_category());
 
-	struct dirent *entry;
-	while((entry = ::readdir(realDirectory.get()))) {
-		std::string name(entry->d_name);
-		if(name == "." || name == "..")
+	if(stream->pending) {
+		listing.append(stream->name.data(), stream->name.size(), stream->attributes);
+		stream->pending = false;
+	}
+
+	std::string name;
+	for(;;) {
+		struct dirent *entry = ::readdir(stream->directory);
+		if(!entry)
+			break;
+
+		name.assign(entry->d_name);
+		if(name == "." || name == ".." || !filter.matches(name))
 			continue;
 
-		v.push_back({name, entry->d_type == DT_DIR});
+		Attributes attributes(kindOfDirent(entry->d_type));
+		attributes.identity = Attributes::Identity{
+			static_cast<uint64_t>(directoryData.st_dev), static_cast<uint64_t>(entry->d_ino)
+		};
+		if(limit != 0 && listing.size() == limit) {
+			resolveUnknown(fd, listing);
+			stream->pending = true;
+			stream->name = std::move(name);
+			stream->attributes = attributes;
+			// token only tells that listing is not at its beginning
+			listing.suspend(listing.resumeToken()+listing.size(), stream);
+			return;
+		}
+		listing.append(name.data(), name.size(), attributes);
 	}
+	resolveUnknown(fd, listing);
+	listing.finish();
+#else
+#error "Platform not supported"
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::scanDirectory(int fd, Listing &listing, size_t limit, const NamePattern &filter) {
+#if BOOST_OS_LINUX && defined(SYS_getdents64)
+	std::unique_ptr<int, std::function<void(int*)>> descriptor(&fd, [](int *fd) {
+		::close(*fd);
+	});
+
+	// layout of records returned by the kernel
+	struct Record {
+		uint64_t inode;
+		int64_t next;
+		unsigned short length;
+		unsigned char type;
+		char name[1];
+	};
 
+	// resume token is offset of the first record not returned yet, as lseek() understands it
+	if(listing.resumeToken() != 0
+			&& ::lseek(fd, static_cast<off_t>(listing.resumeToken()), SEEK_SET) == -1)
+		THROW std::system_error(errno, std::system_category());
+
+	struct ::stat directoryData;
+	if(::fstat(fd, &directoryData) != 0)
+		THROW std::system_error(errno, std::system_category());
+	auto device = static_cast<uint64_t>(directoryData.st_dev);
+
+	bool filtered = (filter.kind() != NamePattern::Kind::Any);
+	std::string name;
+	std::vector<char> buffer(scanBufferSize);
+	Listing::ResumeToken position = listing.resumeToken();
+	for(;;) {
+		long read = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+		if(read == -1)
+			THROW std::system_error(errno, std::system_category());
+		if(read == 0)
+			break;
+
+		for(long offset = 0; offset < read;) {
+			auto record = reinterpret_cast<const Record*>(buffer.data()+offset);
+			offset += record->length;
+			Listing::ResumeToken current = position;
+			position = static_cast<Listing::ResumeToken>(record->next);
+
+			const char *data = record->name;
+			size_t size = ::strlen(data);
+			if((size == 1 && data[0] == '.') || (size == 2 && data[0] == '.' && data[1] == '.'))
+				continue;
+			if(filtered) {
+				name.assign(data, size);
+				if(!filter.matches(name))
+					continue;
+			}
+
+			if(limit != 0 && listing.size() == limit) {
+				resolveUnknown(fd, listing);
+				listing.suspend(current);
+				return;
+			}
+			Attributes attributes(kindOfDirent(record->type));
+			attributes.identity = Attributes::Identity{device, record->inode};
+			listing.append(data, size, attributes);
+		}
+	}
+	resolveUnknown(fd, listing);
+	listing.finish();
+#else
+	readDirectory(fd, listing, limit, filter);
+#endif
+}
+
+void Tial::VFS::NativeFSDriver::resolveUnknown(int fd, Listing &listing) {
+#if (BOOST_OS_UNIX || BOOST_OS_MACOS)
+	// some filesystems do not report types in directory entries at all,
+	// then all of them are asked for in one pass after the listing is read
+	size_t resolved = 0;
+	for(size_t i = 0; i < listing.size(); ++i) {
+		if(listing.attributes(i).kind != Attributes::Kind::Unknown)
+			continue;
+
+		struct ::stat data;
+		if(::fstatat(fd, listing.nameData(i), &data, AT_SYMLINK_NOFOLLOW) != 0) {
+			// removed since it was listed, leave it to be found broken later
+			if(errno == ENOENT)
+				continue;
+			THROW std::system_error(errno, std::system_category());
+		}
+		listing.setAttributes(i, attributesOf(data));
+		++resolved;
+	}
+	if(resolved > 0)
+		LOGN2 << "Types of " << resolved << " entries were not listed, resolved them with fstatat";
 #else
 #error "Platform not supported"
 #endif
-	return v;
+}
+
+Tial::VFS::NativeFSDriver::Scanner Tial::VFS::NativeFSDriver::scanner() const {
+	return _scanner;
+}
+
+void Tial::VFS::NativeFSDriver::setScanner(Scanner scanner) {
+#if !(BOOST_OS_LINUX && defined(SYS_getdents64))
+	if(scanner == Scanner::GetDents) {
+		LOGW << "Scanning with getdents64 is not available on this platform, using readdir";
+		scanner = Scanner::ReadDir;
+	}
+#endif
+	_scanner = scanner;
 }
 
 uintmax_t Tial::VFS::NativeFSDriver::size(const Path &path) {
 	LOGN1 << "path = " << path;
-	return sizeNative(nativeDirectory/path);
+	return sizeNative(path);
 }
 
 void Tial::VFS::NativeFSDriver::resize(const Path &path, uintmax_t size) {
 	LOGN1 << "path = " << path;
-	resizeNative(nativeDirectory/path, size);
+	resizeNative(path, size);
 }
 
 void Tial::VFS::NativeFSDriver::createFile(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
+	LOGN1 << "path = " << path;
+	forgetDescriptors(path);
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	int fd = ::open(std::string(realPath).c_str(), O_CREAT | O_EXCL, S_IRWXU | S_IRWXG | S_IRWXO);
-	if(fd == -1) {
+	int fd = -1;
+	if(at(path, [&fd](int directory, const char *name) {
+		return fd = ::openat(directory, name, O_CREAT | O_EXCL | O_CLOEXEC, S_IRWXU | S_IRWXG | S_IRWXO);
+	}, true) == -1) {
 		if(errno == EEXIST)
 			THROW Exceptions::ElementAlreadyExists(path);
 		THROW std::system_error(errno, std::system_category());
@@ -335,11 +1648,13 @@ void Tial::VFS::NativeFSDriver::createFile(const Path &path) {
 }
 
 void Tial::VFS::NativeFSDriver::removeFile(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
+	LOGN1 << "path = " << path;
+	forgetDescriptors(path);
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	if(::unlink(std::string(realPath).c_str()) == -1) {
+	if(at(path, [](int directory, const char *name) {
+		return ::unlinkat(directory, name, 0);
+	}, true) == -1) {
 		if(errno == ENOENT)
 			THROW Exceptions::ElementNotFound(path, Path());
 		THROW std::system_error(errno, std::system_category());
@@ -350,11 +1665,12 @@ void Tial::VFS::NativeFSDriver::removeFile(const Path &path) {
 }
 
 void Tial::VFS::NativeFSDriver::createDirectory(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
+	LOGN1 << "path = " << path;
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	if(::mkdir(std::string(realPath).c_str(), S_IRWXU | S_IRWXG | S_IRWXO) != 0) {
+	if(at(path, [](int directory, const char *name) {
+		return ::mkdirat(directory, name, S_IRWXU | S_IRWXG | S_IRWXO);
+	}, true) == -1) {
 		if(errno == EEXIST)
 			THROW Exceptions::ElementAlreadyExists(path);
 		THROW std::system_error(errno, std::system_category());
@@ -365,15 +1681,17 @@ void Tial::VFS::NativeFSDriver::createDirectory(const Path &path) {
 }
 
 void Tial::VFS::NativeFSDriver::removeDirectory(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
+	LOGN1 << "path = " << path;
 
 #if (BOOST_OS_UNIX || BOOST_OS_MACOS)
-	if(::rmdir(std::string(realPath).c_str()) != 0) {
+	if(at(path, [](int directory, const char *name) {
+		return ::unlinkat(directory, name, AT_REMOVEDIR);
+	}, true) == -1) {
 		if(errno == ENOTEMPTY)
 			THROW Exceptions::DirectoryNotEmpty(path);
 		THROW std::system_error(errno, std::system_category());
 	}
+	directories.forget(path);
 #else
 #error "Platform not supported"
 #endif
@@ -381,14 +1699,309 @@ void Tial::VFS::NativeFSDriver::removeDirectory(const Path &path) {
 
 std::shared_ptr<Tial::VFS::Driver::OpenFile> Tial::VFS::NativeFSDriver::open(const Path &path) {
 	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
-	Utility::NativePath realPath = nativeDirectory/path;
-	LOGN1 << "path = " << path << ", native path = " << realPath;
-	return descriptor<NativeOpenFile>(realPath);
+	LOGN1 << "path = " << path;
+	return descriptor<NativeOpenFile>(path);
 }
 
 std::shared_ptr<Tial::VFS::Driver::MappedFile> Tial::VFS::NativeFSDriver::map(const Path &path) {
-	Utility::NativePath realPath = nativeDirectory/path;
 	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
-	LOGN1 << "path = " << path << ", native path = " << realPath;
-	return descriptor<NativeMappedFile>(realPath);
+	LOGN1 << "path = " << path;
+	return descriptor<NativeMappedFile>(path);
+}
+
+std::shared_ptr<Tial::VFS::Driver::MappedWindow> Tial::VFS::NativeFSDriver::mapWindow(
+	const Path &path, uintmax_t offset, size_t length, bool writable, bool populate
+) {
+	LOGN1 << "path = " << path << ", offset = " << offset << ", length = " << length;
+	return std::make_shared<NativeMappedWindow>(descriptor<NativeOpenFile>(path), offset, length, writable,
+		populate);
+}
+
+Tial::VFS::Driver::ViewedRange Tial::VFS::NativeFSDriver::view(
+	const Path &path, uintmax_t offset, size_t length
+) {
+	LOGN1 << "path = " << path << ", offset = " << offset << ", length = " << length;
+	auto file = descriptor<NativeOpenFile>(path);
+	// size is not allowed to change between checking it and pinning the range
+	std::unique_lock<std::mutex> lock(file->viewsMutex);
+	uintmax_t size = file->size();
+	if(offset >= size)
+		return ViewedRange();
+	length = static_cast<size_t>(std::min<uintmax_t>(length, size-offset));
+	if(length <= viewCopyLimit) {
+		lock.unlock();
+		return copyRange(*file, offset, length);
+	}
+
+	auto window = std::make_shared<NativeMappedWindow>(file, offset, length, false, false);
+	uintmax_t end = offset+length;
+	file->viewEnds.insert(end);
+	ViewedRange range;
+	range.data = window->get();
+	range.size = length;
+	// deleter lives as long as weak pointers to the range, so it lets go of the mapping once called
+	range.owner = std::shared_ptr<const void>(range.data, [file, window, end](const void*) mutable {
+		{
+			std::unique_lock<std::mutex> lock(file->viewsMutex);
+			file->viewEnds.erase(file->viewEnds.find(end));
+		}
+		window.reset();
+		file.reset();
+	});
+	return range;
+}
+
+void Tial::VFS::NativeFSDriver::readMany(std::vector<ReadRequest> &requests, ThreadPool &pool, size_t queueDepth) {
+	LOGN1 << "requests = " << requests.size() << ", queueDepth = " << queueDepth;
+	if(ringAvailable && readManyRing(requests, pool, queueDepth))
+		return;
+	Driver::readMany(requests, pool, queueDepth);
+}
+
+bool Tial::VFS::NativeFSDriver::readManyRing(std::vector<ReadRequest> &requests, ThreadPool &pool, size_t queueDepth) {
+#if BOOST_OS_LINUX && defined(IORING_FEAT_CQE_SKIP)
+	// every request takes one slot of descriptor table and three queue entries
+	unsigned depth = static_cast<unsigned>(std::min<size_t>(std::max<size_t>(queueDepth, 1), 4096));
+	std::unique_lock<std::mutex> lock(ringMutex, std::try_to_lock);
+	std::shared_ptr<Ring> ring;
+	if(lock && ringDepth == depth)
+		ring = std::static_pointer_cast<Ring>(this->ring);
+	if(!ring) {
+		try {
+			ring = std::make_shared<Ring>(3*depth, depth);
+		} catch(const std::system_error &e) {
+			LOGI << "io_uring is not usable (" << e.what() << "), batches will be read with thread pool";
+			ringAvailable = false;
+			return false;
+		}
+		if(lock) {
+			this->ring = ring;
+			ringDepth = depth;
+		}
+	}
+	// longer requests than one read transfers are left to thread pool
+	const size_t readLimit = transferLimit();
+
+	struct Slot {
+		size_t request;
+		std::shared_ptr<DirectoryDescriptors::Descriptor> directory;
+		bool cached;
+		int remaining;
+		int opened;
+		int read;
+	};
+	std::vector<Slot> slots(depth);
+	std::vector<unsigned> free;
+	for(unsigned i = depth; i > 0; --i)
+		free.push_back(i-1);
+	// requests that failed under a cached directory, read again at the end if it was gone
+	std::vector<size_t> stale;
+	std::vector<size_t> large;
+
+	size_t next = 0, inFlight = 0;
+	try {
+		while(next < requests.size() || inFlight > 0) {
+			for(; next < requests.size() && !free.empty(); ++next) {
+				auto &request = requests[next];
+				request.transferred = 0;
+				request.error = nullptr;
+				if(request.path.size() < 2) {
+					request.error = std::make_exception_ptr(std::system_error(EISDIR, std::system_category()));
+					continue;
+				}
+				if(request.buffer.size > readLimit) {
+					large.push_back(next);
+					continue;
+				}
+
+				bool cached = false;
+				auto directory = directories.get(request.path.subpath(0, request.path.size()-1), cached);
+				if(!directory) {
+					if(cached && (errno == ENOENT || errno == ENOTDIR))
+						stale.push_back(next);
+					request.error = std::make_exception_ptr(std::system_error(errno, std::system_category()));
+					continue;
+				}
+
+				unsigned slot = free.back();
+				free.pop_back();
+				slots[slot] = Slot{next, directory, cached, 3, 0, 0};
+				++inFlight;
+
+				// hard links keep the chain going on failure, so the descriptor is always closed
+				auto open = ring->next(), read = ring->next(), close = ring->next();
+				assert(open && read && close);
+				open->opcode = IORING_OP_OPENAT;
+				open->fd = directory->get();
+				open->addr = reinterpret_cast<uint64_t>(request.path[request.path.size()-1].c_str());
+				// direct descriptors are never inherited, kernel refuses O_CLOEXEC for them
+				open->open_flags = O_RDONLY;
+				open->file_index = slot+1;
+				open->flags = IOSQE_IO_HARDLINK;
+				open->user_data = 3*static_cast<uint64_t>(slot);
+
+				read->opcode = IORING_OP_READ;
+				read->fd = static_cast<int>(slot);
+				read->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+				read->addr = reinterpret_cast<uint64_t>(request.buffer.data);
+				read->len = static_cast<uint32_t>(request.buffer.size);
+				read->off = request.offset;
+				read->user_data = 3*static_cast<uint64_t>(slot)+1;
+
+				close->opcode = IORING_OP_CLOSE;
+				close->file_index = slot+1;
+				close->user_data = 3*static_cast<uint64_t>(slot)+2;
+			}
+
+			// everything left failed before submission, there is nothing to wait for
+			if(inFlight == 0)
+				continue;
+
+			ring->submit(1);
+			ring->reap([&](const io_uring_cqe &cqe) {
+				auto &slot = slots[cqe.user_data/3];
+				switch(cqe.user_data%3) {
+				case 0: slot.opened = cqe.res; break;
+				case 1: slot.read = cqe.res; break;
+				default: break;
+				}
+				if(--slot.remaining > 0)
+					return;
+
+				auto &request = requests[slot.request];
+				if(slot.opened < 0) {
+					if(slot.cached && slot.opened == -ENOENT)
+						stale.push_back(slot.request);
+					request.error = std::make_exception_ptr(std::system_error(-slot.opened, std::system_category()));
+				} else if(slot.read < 0)
+					request.error = std::make_exception_ptr(std::system_error(-slot.read, std::system_category()));
+				else
+					request.transferred = static_cast<size_t>(slot.read);
+
+				slot.directory.reset();
+				free.push_back(static_cast<unsigned>(cqe.user_data/3));
+				--inFlight;
+			});
+		}
+	} catch(...) {
+		// whatever is still in flight is cancelled when the ring is closed
+		if(lock)
+			this->ring.reset();
+		throw;
+	}
+	if(lock)
+		lock.unlock();
+
+	// retried all together if any of their cached directories turned out not to be current
+	bool retry = false;
+	for(auto i: stale)
+		retry = directories.stale(requests[i].path.subpath(0, requests[i].path.size()-1)) || retry;
+	if(retry) {
+		LOGN2 << "Cached directories of " << stale.size() << " requests are stale, reading them again";
+		large.insert(large.end(), stale.begin(), stale.end());
+	}
+	if(!large.empty()) {
+		std::vector<ReadRequest> pooled;
+		for(auto i: large)
+			pooled.push_back(requests[i]);
+		Driver::readMany(pooled, pool, queueDepth);
+		for(size_t i = 0; i < large.size(); ++i)
+			requests[large[i]] = pooled[i];
+	}
+	return true;
+#else
+	unused(requests);
+	unused(pool);
+	unused(queueDepth);
+	return false;
+#endif
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::NativeFSDriver::transferAsync(const Path &path, uintmax_t pos, void *data,
+		size_t size, bool write, const std::shared_ptr<Executor> &executor) {
+#if BOOST_OS_LINUX && defined(IORING_FEAT_CQE_SKIP)
+	std::shared_ptr<AsyncRing> ring;
+	{
+		std::unique_lock<std::mutex> lock(asyncRingMutex);
+		if(!asyncRing && asyncRingAvailable) {
+			try {
+				auto created = std::make_shared<AsyncRing>(asyncRingEntries);
+				created->start();
+				asyncRing = created;
+			} catch(const std::system_error &e) {
+				LOGI << "io_uring is not usable (" << e.what() << "), transfers will run on executor";
+				asyncRingAvailable = false;
+			}
+		}
+		ring = std::static_pointer_cast<AsyncRing>(asyncRing);
+	}
+	if(!ring)
+		return Task<size_t>();
+
+	Promise<size_t> promise;
+	auto task = promise.task();
+	try {
+		auto file = descriptor<NativeOpenFile>(path);
+		std::unique_ptr<AsyncRing::Operation> operation(new AsyncRing::Operation{
+			file, file->fd, write, pos, static_cast<char*>(data), size, 0, promise, executor
+		});
+		ring->submit(operation.get());
+		operation.release();
+	} catch(...) {
+		promise.setException(std::current_exception());
+	}
+	return task;
+#else
+	unused(path);
+	unused(pos);
+	unused(data);
+	unused(size);
+	unused(write);
+	unused(executor);
+	return Task<size_t>();
+#endif
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::NativeFSDriver::readAsync(const Path &path, uintmax_t pos, const Buffer &buffer,
+		const std::shared_ptr<Executor> &executor) {
+	LOGN1 << "path = " << path << ", pos = " << pos << ", size = " << buffer.size;
+	auto task = transferAsync(path, pos, buffer.data, buffer.size, false, executor);
+	return task.valid() ? task : Driver::readAsync(path, pos, buffer, executor);
+}
+
+Tial::VFS::Task<size_t> Tial::VFS::NativeFSDriver::writeAsync(const Path &path, uintmax_t pos, const ConstBuffer &buffer,
+		const std::shared_ptr<Executor> &executor) {
+	LOGN1 << "path = " << path << ", pos = " << pos << ", size = " << buffer.size;
+	// never written to when reading, the ring takes one pointer for both directions
+	auto task = transferAsync(path, pos, const_cast<void*>(buffer.data), buffer.size, true, executor);
+	return task.valid() ? task : Driver::writeAsync(path, pos, buffer, executor);
+}
+
+size_t Tial::VFS::NativeFSDriver::directoryCacheCapacity() const {
+	return directories.capacity();
+}
+
+void Tial::VFS::NativeFSDriver::setDirectoryCacheCapacity(size_t capacity) {
+	directories.setCapacity(capacity);
+}
+
+Tial::VFS::NativeFSDriver::DirectoryCacheStatistics Tial::VFS::NativeFSDriver::directoryCacheStatistics() const {
+	return directories.statistics();
+}
+
+size_t Tial::VFS::NativeFSDriver::descriptorCacheCapacity() const {
+	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+	return _descriptorCacheCapacity;
+}
+
+void Tial::VFS::NativeFSDriver::setDescriptorCacheCapacity(size_t capacity) {
+	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+	LOGN1 << "capacity = " << capacity;
+	_descriptorCacheCapacity = capacity;
+	evictDescriptors();
+}
+
+Tial::VFS::NativeFSDriver::DescriptorCacheStatistics Tial::VFS::NativeFSDriver::descriptorCacheStatistics() const {
+	std::unique_lock<std::recursive_mutex> lock(openDescriptorsMutex);
+	return _descriptorCacheStatistics;
 }
@@ -1,42 +1,106 @@
 #include "Object.hpp"
 #include "Directory.hpp"
 #include "Exception.hpp"
+#include "Root.hpp"
 
 #define TIAL_MODULE "Tial::VFS::Object"
 
+namespace {
+
+const uint64_t validityBits = 2;
+const uint64_t validityMask = (1u << validityBits) - 1;
+
+inline uint64_t pack(uint64_t epoch, Tial::VFS::Object::Validity validity) {
+	return (epoch << validityBits) | static_cast<uint64_t>(validity);
+}
+
+inline Tial::VFS::Object::Validity validityOf(uint64_t state) {
+	return static_cast<Tial::VFS::Object::Validity>(state & validityMask);
+}
+
+inline uint64_t epochOf(uint64_t state) {
+	return state >> validityBits;
+}
+
+}
+
 Tial::VFS::Object::Object(
 	const std::shared_ptr<Root> &root,
 	const std::shared_ptr<Directory> &parent,
 	const std::string &name
-): _root(root), _parent(parent), _name(name) {}
+): _root(root), _parent(parent), _topLevel(!parent), _state(pack(0, Validity::Invalid)),
+	_checked(~static_cast<uint64_t>(0)), _name(name) {}
+
+std::shared_ptr<Tial::VFS::Root> Tial::VFS::Object::treeRoot() const {
+	if(auto root = _root.lock())
+		return root;
+	if(_topLevel)
+		return std::dynamic_pointer_cast<Root>(std::const_pointer_cast<Object>(shared_from_this()));
+	return nullptr;
+}
+
+bool Tial::VFS::Object::setState(Validity validity, uintmax_t epoch) {
+	auto state = _state.load();
+	do {
+		if(validityOf(state) == Validity::Broken)
+			return false; // broken is final
+	} while(!_state.compare_exchange_weak(state, pack(epoch, validity)));
+	return true;
+}
+
+void Tial::VFS::Object::advanceEpoch(bool invalidateLookups) {
+	auto root = treeRoot();
+	if(!root)
+		return;
+	++root->_epoch;
+	if(invalidateLookups)
+		root->lookupCache().invalidate();
+}
 
 void Tial::VFS::Object::validate() {
-	if(_valid == Validity::Broken)
-		THROW Exceptions::ElementBroken();
-	_valid = Validity::Valid;
+	checkIfBroken();
+	markValid(validateParent());
 }
 
 void Tial::VFS::Object::validate() const {
 	const_cast<Object*>(this)->validate();
 }
 
-void Tial::VFS::Object::markValid() {
+uintmax_t Tial::VFS::Object::validateParent() {
+	if(_topLevel)
+		return 0;
+
+	auto parent = _parent.lock();
+	if(!parent) {
+		markBroken();
+		checkIfBroken();
+	}
+
+	static_cast<Object&>(*parent).validate();
+	checkIfBroken();
+	return parent->_generation;
+}
+
+void Tial::VFS::Object::markValid(uintmax_t epoch) {
 	LOGN3 << "Marking " << *this << " as valid";
-	_valid = Validity::Valid;
+	if(setState(Validity::Valid, epoch))
+		advanceEpoch(false);
 }
 
 void Tial::VFS::Object::markInvalid() {
 	LOGN3 << "Marking " << *this << " as invalid";
-	_valid = Validity::Invalid;
+	setState(Validity::Invalid, 0);
+	advanceEpoch(true);
 }
 
 void Tial::VFS::Object::markBroken() {
 	LOGN3 << "Marking " << *this << " as broken";
-	_valid = Validity::Broken;
+	_state = pack(0, Validity::Broken);
+	advanceEpoch(true);
 }
 
 void Tial::VFS::Object::checkIfBroken() const {
-	if(_valid == Validity::Broken) {
+	if(valid() == Validity::Broken) {
 		LOGW << "Element " << *this << " is broken";
 		THROW Exceptions::ElementBroken();
 	}
@@ -50,7 +114,33 @@ std::string Tial::VFS::Object::name() const {
 }
 
 Tial::VFS::Object::Validity Tial::VFS::Object::valid() const {
-	return _valid;
+	auto state = _state.load();
+	auto own = validityOf(state);
+	if(own == Validity::Broken || _topLevel)
+		return own;
+
+	// nothing in the tree changed since last check
+	auto root = _root.lock();
+	uint64_t epoch = root ? root->_epoch.load() : 0;
+	auto checked = _checked.load();
+	if(root && epochOf(checked) == epoch)
+		return validityOf(checked);
+
+	auto result = own;
+	auto parent = _parent.lock();
+	auto parentValidity = parent ? parent->valid() : Validity::Broken;
+	if(parentValidity == Validity::Broken) {
+		result = Validity::Broken;
+		_state = pack(0, Validity::Broken);
+	} else if(own == Validity::Valid) {
+		// parent was invalidated or relisted since this object was validated
+		if(parentValidity != Validity::Valid || epochOf(state) != parent->_generation)
+			result = Validity::Invalid;
+	}
+
+	if(root)
+		_checked = pack(epoch, result);
+	return result;
 }
 
 std::shared_ptr<Tial::VFS::Root> Tial::VFS::Object::root() {
@@ -73,6 +163,13 @@ void Tial::VFS::Object::remove() {
 	THROW Exception("not implemented");
 }
 
+Tial::VFS::Task<void> Tial::VFS::Object::removeAsync() {
+	auto self = shared_from_this();
+	return async(*root()->executor(), [self]() {
+		self->remove();
+	});
+}
+
 Tial::Utility::Logger::Stream &
 Tial::VFS::operator<<(Utility::Logger::Stream &s, const Object &object) {
 	return s << typeid(object) << reinterpret_cast<const void*>(&object) << "{" << object._name << "}";
@@ -1,6 +1,14 @@
 #include "Root.hpp"
+#include "File.hpp"
 
-Tial::VFS::Root::Root(): Directory(nullptr, nullptr, "/") {}
+#include <TialUtility/TialUtility.hpp>
+
+#include <stdexcept>
+
+#define TIAL_MODULE "Tial::VFS::Root"
+
+Tial::VFS::Root::Root(): Directory(nullptr, nullptr, "/"),
+		_workerCount(std::max(std::thread::hardware_concurrency(), 1u)) {}
 
 Tial::VFS::Path Tial::VFS::Root::path() const {
 	return "/";
@@ -13,3 +21,104 @@ std::shared_ptr<Tial::VFS::Root> Tial::VFS::Root::root() {
 std::shared_ptr<Tial::VFS::Directory> Tial::VFS::Root::parent() const {
 	return nullptr;
 }
+
+Tial::VFS::LookupCache &Tial::VFS::Root::lookupCache() {
+	return _lookupCache;
+}
+
+std::shared_ptr<Tial::VFS::ThreadPool> Tial::VFS::Root::threadPool() {
+	std::unique_lock<std::mutex> lock(threadPoolMutex);
+	if(!_threadPool) {
+		_threadPool = std::make_shared<ThreadPool>(_workerCount);
+		poolExecutor = std::make_shared<ThreadPoolExecutor>(_threadPool);
+	}
+	return _threadPool;
+}
+
+size_t Tial::VFS::Root::workerCount() {
+	std::unique_lock<std::mutex> lock(threadPoolMutex);
+	return _workerCount;
+}
+
+void Tial::VFS::Root::readMany(std::vector<ReadRequest> &requests) {
+	LOGN1 << "requests = " << requests.size();
+
+	struct Batch {
+		std::shared_ptr<Driver> driver;
+		std::vector<Driver::ReadRequest> requests;
+		std::vector<size_t> indices;
+	};
+	std::vector<Batch> batches;
+
+	for(size_t i = 0; i < requests.size(); ++i) {
+		auto &request = requests[i];
+		request.transferred = 0;
+		request.error = nullptr;
+		try {
+			if(!request.file)
+				THROW std::invalid_argument("Read request without file");
+			request.file->validate();
+			auto d = request.file->parent()->driver();
+
+			auto batch = std::find_if(batches.begin(), batches.end(), [&d](const Batch &batch) {
+				return batch.driver == d.second;
+			});
+			if(batch == batches.end())
+				batch = batches.insert(batches.end(), Batch{d.second, {}, {}});
+
+			Driver::ReadRequest driverRequest;
+			driverRequest.path = d.first/request.file->_name;
+			driverRequest.offset = request.offset;
+			driverRequest.buffer = request.buffer;
+			batch->requests.push_back(std::move(driverRequest));
+			batch->indices.push_back(i);
+		} catch(...) {
+			request.error = std::current_exception();
+		}
+	}
+
+	auto pool = threadPool();
+	for(auto &batch: batches) {
+		LOGN2 << "Reading " << batch.requests.size() << " files using driver " << batch.driver;
+		batch.driver->readMany(batch.requests, *pool, queueDepth());
+		for(size_t i = 0; i < batch.indices.size(); ++i) {
+			requests[batch.indices[i]].transferred = batch.requests[i].transferred;
+			requests[batch.indices[i]].error = batch.requests[i].error;
+		}
+	}
+}
+
+size_t Tial::VFS::Root::queueDepth() const {
+	return _queueDepth;
+}
+
+void Tial::VFS::Root::setQueueDepth(size_t queueDepth) {
+	_queueDepth = std::max<size_t>(queueDepth, 1);
+}
+
+void Tial::VFS::Root::setWorkerCount(size_t workerCount) {
+	std::unique_lock<std::mutex> lock(threadPoolMutex);
+	if(workerCount == _workerCount)
+		return;
+	_workerCount = workerCount;
+	// traversals running on old pool keep it alive until they finish
+	_threadPool.reset();
+	poolExecutor.reset();
+}
+
+std::shared_ptr<Tial::VFS::Executor> Tial::VFS::Root::executor() {
+	{
+		std::unique_lock<std::mutex> lock(threadPoolMutex);
+		if(_executor)
+			return _executor;
+	}
+	auto pool = threadPool();
+	std::unique_lock<std::mutex> lock(threadPoolMutex);
+	// worker count may have changed in the meantime
+	return poolExecutor ? poolExecutor : std::make_shared<ThreadPoolExecutor>(pool);
+}
+
+void Tial::VFS::Root::setExecutor(const std::shared_ptr<Executor> &executor) {
+	std::unique_lock<std::mutex> lock(threadPoolMutex);
+	_executor = executor;
+}
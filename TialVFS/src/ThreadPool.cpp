@@ -0,0 +1,176 @@
+#include "ThreadPool.hpp"
+
+#include <TialUtility/TialUtility.hpp>
+
+#define TIAL_MODULE "Tial::VFS::ThreadPool"
+
+namespace {
+
+// pool and deque owned by current thread, if it is a worker
+thread_local Tial::VFS::ThreadPool *currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+}
+
+Tial::VFS::ThreadPool::ThreadPool(size_t workers) {
+	LOGN1 << "Starting " << workers << " workers";
+	// there is always at least one deque, for tasks submitted to a pool without workers
+	for(size_t i = 0; i < std::max<size_t>(workers, 1); ++i)
+		this->workers.emplace_back(new Worker);
+	for(size_t i = 0; i < workers; ++i)
+		this->workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+}
+
+Tial::VFS::ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for(auto &worker: workers)
+		if(worker->thread.joinable())
+			worker->thread.join();
+
+	// pool without workers drains on destruction as well
+	while(runPending());
+}
+
+size_t Tial::VFS::ThreadPool::size() const {
+	size_t size = 0;
+	for(auto &worker: workers)
+		if(worker->thread.joinable())
+			++size;
+	return size;
+}
+
+void Tial::VFS::ThreadPool::submit(Task task) {
+	size_t index = (currentPool == this) ? currentWorker : (next++ % workers.size());
+	++queued;
+	{
+		std::unique_lock<std::mutex> lock(workers[index]->mutex);
+		workers[index]->tasks.push_back(std::move(task));
+	}
+	{
+		std::unique_lock<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
+
+bool Tial::VFS::ThreadPool::runPending() {
+	Task task;
+	bool found = (currentPool == this)
+		? (pop(currentWorker, task) || steal(currentWorker, task))
+		: steal(workers.size(), task);
+	if(!found)
+		return false;
+	--queued;
+	task();
+	return true;
+}
+
+bool Tial::VFS::ThreadPool::pop(size_t index, Task &task) {
+	auto &worker = *workers[index];
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	if(worker.tasks.empty())
+		return false;
+	task = std::move(worker.tasks.back());
+	worker.tasks.pop_back();
+	return true;
+}
+
+bool Tial::VFS::ThreadPool::steal(size_t index, Task &task) {
+	for(size_t i = 1; i <= workers.size(); ++i) {
+		auto &victim = *workers[(index+i) % workers.size()];
+		std::unique_lock<std::mutex> lock(victim.mutex);
+		if(victim.tasks.empty())
+			continue;
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+void Tial::VFS::ThreadPool::run(size_t index) {
+	currentPool = this;
+	currentWorker = index;
+
+	for(;;) {
+		Task task;
+		if(pop(index, task) || steal(index, task)) {
+			--queued;
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() {
+			return stopping || queued > 0;
+		});
+		if(stopping && queued == 0)
+			return;
+	}
+}
+
+Tial::VFS::TaskGroup::TaskGroup(ThreadPool &pool): pool(pool) {}
+
+Tial::VFS::TaskGroup::~TaskGroup() {
+	try {
+		wait();
+	} catch(...) {
+		LOGW << "Exception of task group was not handled";
+	}
+}
+
+void Tial::VFS::TaskGroup::run(ThreadPool::Task task) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++pending;
+	}
+	pool.submit([this, task]() {
+		try {
+			if(!_failed)
+				task();
+		} catch(...) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if(!error)
+				error = std::current_exception();
+			_failed = true;
+		}
+
+		// waiter may destroy the group as soon as it sees no pending tasks, so the
+		// counter is only read and written with mutex held
+		std::unique_lock<std::mutex> lock(mutex);
+		if(--pending == 0)
+			done.notify_all();
+	});
+}
+
+void Tial::VFS::TaskGroup::wait() {
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if(pending == 0)
+				break;
+		}
+		if(pool.runPending())
+			continue;
+
+		// remaining tasks are running elsewhere, they may still spawn new ones
+		std::unique_lock<std::mutex> lock(mutex);
+		if(pending == 0)
+			break;
+		done.wait_for(lock, std::chrono::milliseconds(1));
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	if(error) {
+		auto e = error;
+		error = nullptr;
+		std::rethrow_exception(e);
+	}
+}
+
+bool Tial::VFS::TaskGroup::failed() const {
+	return _failed;
+}
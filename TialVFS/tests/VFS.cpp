@@ -3,7 +3,13 @@
 #include <TialUtility/TialUtility.hpp>
 #include <TialVFS/TialVFS.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
+#include <future>
+#include <iomanip>
+#include <set>
 #include <thread>
 #include <boost/algorithm/string.hpp>
 
@@ -23,20 +29,53 @@ auto sortFiles = [](
 	return first->path() < second->path();
 };
 
+#if defined(__cpp_impl_coroutine)
+// started right away and never waited for, just enough to await tasks
+struct Detached {
+	struct promise_type {
+		Detached get_return_object() {
+			return {};
+		}
+		std::suspend_never initial_suspend() noexcept {
+			return {};
+		}
+		std::suspend_never final_suspend() noexcept {
+			return {};
+		}
+		void return_void() {}
+		void unhandled_exception() {
+			std::terminate();
+		}
+	};
+};
+
+static Detached awaitSum(Tial::VFS::Task<size_t> first, Tial::VFS::Task<size_t> second, std::promise<size_t> &sum) {
+	size_t a = co_await first;
+	size_t b = co_await second;
+	sum.set_value(a+b);
+}
+#endif
+
 class MountPointWrapper {
 private:
 	std::shared_ptr<Tial::VFS::Root> _root;
 	std::shared_ptr<Tial::VFS::Directory> mountPoint;
+	std::shared_ptr<Tial::VFS::Driver> _driver;
 public:
 	MountPointWrapper(
 		std::shared_ptr<Tial::VFS::Root> root,
-		std::shared_ptr<Tial::VFS::Directory> mountPoint
-	): _root(root), mountPoint(mountPoint) {}
+		std::shared_ptr<Tial::VFS::Directory> mountPoint,
+		std::shared_ptr<Tial::VFS::Driver> driver
+	): _root(root), mountPoint(mountPoint), _driver(driver) {}
 
 	std::shared_ptr<Tial::VFS::Root> root() {
 		return _root;
 	}
 
+	std::shared_ptr<Tial::VFS::Driver> driver() {
+		return _driver;
+	}
+
 	std::shared_ptr<Tial::VFS::Directory> get() {
 		return mountPoint;
 	}
@@ -408,8 +447,8 @@ class [[Testing::CaseBase]] VFS {
 		// now, we remove what was referenced before
 		[[Check::NoThrow]] root->get<Tial::VFS::Directory>("Asia")->get<Tial::VFS::Directory>("Indonesia")->remove();
 
-		// and it disappears from existing references too
-		[[Check::Verify]] (asia1->valid() == Tial::VFS::Directory::Validity::Invalid);
+		// and it disappears from existing references too, without relisting
+		[[Check::Verify]] (asia1->valid() == Tial::VFS::Directory::Validity::Valid);
 		auto content4 = [[Check::NoThrow]] asia1->content();
 		[[Check::Verify]] (asia1->valid() == Tial::VFS::Directory::Validity::Valid);
 		std::sort(content4.begin(), content4.end(), sortFiles);
@@ -513,6 +552,182 @@ class [[Testing::CaseBase]] VFS {
 		[[Check::Throw(Exceptions::ElementBroken)]] bar->path();
 	}
 
+	static void driverTestLazyInvalidation(MountPointWrapper root) {
+		[[Check::NoThrow]] root->unmount();
+		auto testDriver = [[Check::NoThrow]] std::make_shared<TestDriverInvalidable>();
+		[[Check::NoThrow]] root->mount(testDriver);
+
+		auto x = [[Check::NoThrow]] root->createDirectory("x");
+		auto y = [[Check::NoThrow]] x->createDirectory("y");
+		auto z = [[Check::NoThrow]] y->createDirectory("z");
+		[[Check::Verify]] (z->content().size()) == 0u;
+		[[Check::Verify]] (x->valid()) == Tial::VFS::Object::Validity::Valid;
+		[[Check::Verify]] (y->valid()) == Tial::VFS::Object::Validity::Valid;
+		[[Check::Verify]] (z->valid()) == Tial::VFS::Object::Validity::Valid;
+
+		// invalidation of the mount point reaches whole subtree
+		[[Check::NoThrow]] testDriver->testDirectoryCreate();
+		[[Check::Verify]] (root->valid()) == Tial::VFS::Object::Validity::Invalid;
+		[[Check::Verify]] (x->valid()) == Tial::VFS::Object::Validity::Invalid;
+		[[Check::Verify]] (y->valid()) == Tial::VFS::Object::Validity::Invalid;
+		[[Check::Verify]] (z->valid()) == Tial::VFS::Object::Validity::Invalid;
+
+		// using deepest element validates whole chain again, keeping objects
+		[[Check::Verify]] (z->content().size()) == 0u;
+		[[Check::Verify]] (root->valid()) == Tial::VFS::Object::Validity::Valid;
+		[[Check::Verify]] (x->valid()) == Tial::VFS::Object::Validity::Valid;
+		[[Check::Verify]] (y->valid()) == Tial::VFS::Object::Validity::Valid;
+		[[Check::Verify]] (z->valid()) == Tial::VFS::Object::Validity::Valid;
+		[[Check::Verify]] (root->get<Tial::VFS::Directory>("x/y/z")) == z;
+		[[Check::Verify]] (root->content().size()) == 2u;
+	}
+
+	static void driverTestReconciliation(MountPointWrapper root) {
+		[[Check::NoThrow]] root->unmount();
+		auto testDriver = [[Check::NoThrow]] std::make_shared<TestDriverInvalidable>();
+		[[Check::NoThrow]] root->mount(testDriver);
+
+		[[Check::Verify]] (root->content().size()) == 0u;
+		[[Check::Verify]] (root->reconciliation().added) == 0u;
+
+		[[Check::NoThrow]] testDriver->testDirectoryCreate();
+		auto foo = [[Check::NoThrow]] root->get<Tial::VFS::Directory>("foo");
+		[[Check::Verify]] (root->reconciliation().added) == 1u;
+		[[Check::Verify]] (root->reconciliation().removed) == 0u;
+		[[Check::Verify]] (root->reconciliation().kept) == 0u;
+
+		[[Check::NoThrow]] testDriver->testDirectoryCreate2();
+		auto bar = [[Check::NoThrow]] root->get<Tial::VFS::Directory>("bar");
+		[[Check::Verify]] (root->reconciliation().added) == 1u;
+		[[Check::Verify]] (root->reconciliation().removed) == 0u;
+		[[Check::Verify]] (root->reconciliation().kept) == 1u;
+		[[Check::Verify]] (root->get<Tial::VFS::Directory>("foo")) == foo;
+
+		[[Check::NoThrow]] testDriver->testDirectoryRemove();
+		[[Check::Verify]] (root->content().size()) == 1u;
+		[[Check::Verify]] (root->reconciliation().added) == 0u;
+		[[Check::Verify]] (root->reconciliation().removed) == 1u;
+		[[Check::Verify]] (root->reconciliation().kept) == 1u;
+		[[Check::Verify]] (root->get<Tial::VFS::Directory>("bar")) == bar;
+		[[Check::Verify]] (foo->valid()) == Tial::VFS::Object::Validity::Broken;
+	}
+
+	class TestDriverCountingListings: public Tial::VFS::MemoryDriver {
+	public:
+		size_t listings = 0;
+		size_t filteredListings = 0;
+
+		TestDriverCountingListings(): Tial::VFS::MemoryDriver("TestDriverCountingListings") {}
+
+		using Tial::VFS::MemoryDriver::listDirectory;
+
+		virtual void listDirectory(const Tial::VFS::Path &path, Listing &listing, size_t limit,
+				const Tial::VFS::NamePattern &filter) override {
+			if(filter.kind() == Tial::VFS::NamePattern::Kind::Any)
+				++listings;
+			else
+				++filteredListings;
+			Tial::VFS::MemoryDriver::listDirectory(path, listing, limit, filter);
+		}
+	};
+
+	static void driverTestCreateRemoveWithoutListing(MountPointWrapper root) {
+		[[Check::NoThrow]] root->unmount();
+		auto testDriver = [[Check::NoThrow]] std::make_shared<TestDriverCountingListings>();
+		[[Check::NoThrow]] root->mount(testDriver);
+
+		auto directory = [[Check::NoThrow]] root->createDirectory("directory");
+		[[Check::Verify]] (directory->content().size()) == 0u;
+		auto listings = testDriver->listings;
+
+		for(int i = 0; i < 100; ++i)
+			[[Check::NoThrow]] directory->createFile(std::to_string(i));
+		[[Check::Verify]] (directory->content().size()) == 100u;
+		for(int i = 0; i < 50; ++i)
+			[[Check::NoThrow]] directory->get<Tial::VFS::File>(std::to_string(i))->remove();
+		[[Check::Verify]] (directory->content().size()) == 50u;
+		for(int i = 0; i < 10; ++i)
+			[[Check::NoThrow]] directory->createDirectory("subdirectory" + std::to_string(i));
+		[[Check::Verify]] (directory->content().size()) == 60u;
+		[[Check::Verify]] (testDriver->listings) == listings;
+
+		[[Check::NoThrow]] directory->remove();
+		[[Check::Verify]] (root->content().size()) == 0u;
+	}
+
+	static void driverTestFilteredListing(MountPointWrapper root) {
+		[[Check::NoThrow]] root->unmount();
+		auto testDriver = [[Check::NoThrow]] std::make_shared<TestDriverCountingListings>();
+		[[Check::NoThrow]] testDriver->createDirectory("/directory");
+		for(int i = 0; i < 100; ++i)
+			[[Check::NoThrow]] testDriver->createFile("/directory/" + std::to_string(i));
+		[[Check::NoThrow]] root->mount(testDriver);
+
+		auto directory = [[Check::NoThrow]] root->get<Tial::VFS::Directory>("directory");
+		auto listings = testDriver->listings;
+
+		auto some = [[Check::NoThrow]] directory->content(Tial::VFS::NamePattern("1?"));
+		[[Check::Verify]] (some.size()) == 10u;
+		[[Check::Verify]] (directory->content(Tial::VFS::NamePattern::prefix("9")).size()) == 11u;
+		[[Check::Verify]] (root->getAll("directory/*5").size()) == 10u;
+		[[Check::Verify]] (testDriver->filteredListings) == 3u;
+		[[Check::Verify]] (testDriver->listings) == listings;
+		[[Check::Verify]] (directory->valid()) == Tial::VFS::Object::Validity::Invalid;
+
+		// partially populated objects survive full listing
+		[[Check::Verify]] (directory->content().size()) == 100u;
+		[[Check::Verify]] (testDriver->listings) == listings+1;
+		[[Check::Verify]] (root->get<Tial::VFS::File>("directory/" + some[0]->name())) == some[0];
+		[[Check::Verify]] (some[0]->valid()) == Tial::VFS::Object::Validity::Valid;
+
+		// once listed, filters are answered from cache
+		[[Check::Verify]] (directory->content(Tial::VFS::NamePattern::prefix("9")).size()) == 11u;
+		[[Check::Verify]] (testDriver->filteredListings) == 3u;
+
+		auto driver = std::make_shared<Tial::VFS::MemoryDriver>();
+		[[Check::NoThrow]] driver->createFile("/Alpha");
+		[[Check::NoThrow]] driver->createFile("/beta");
+		[[Check::Verify]] (driver->listDirectory("/", Tial::VFS::NamePattern("*a")).size()) == 2u;
+		[[Check::Verify]] (driver->listDirectory("/", Tial::VFS::NamePattern("a*")).size()) == 0u;
+		[[Check::Verify]] (driver->listDirectory("/", Tial::VFS::NamePattern("a*", false)).size()) == 1u;
+		[[Check::Verify]] (driver->listDirectory("/", Tial::VFS::NamePattern::prefix("be")).size()) == 1u;
+	}
+
+	static void driverTestPagedListing(MountPointWrapper root) {
+		auto directory = [[Check::NoThrow]] root->createDirectory("paged");
+		for(int i = 0; i < 250; ++i)
+			[[Check::NoThrow]] directory->createFile("file" + std::to_string(i));
+		[[Check::NoThrow]] directory->createDirectory("subdirectory");
+
+		auto driver = root.driver();
+		Tial::VFS::Path path("/paged");
+
+		std::set<std::string> names;
+		size_t pages = 0, directories = 0;
+		Tial::VFS::Driver::Listing listing;
+		while(!listing.complete()) {
+			[[Check::NoThrow]] driver->listDirectory(path, listing, 100);
+			[[Check::Verify]] (listing.size() <= 100u) == true;
+			for(size_t i = 0; i < listing.size(); ++i) {
+				[[Check::Verify]] (std::strlen(listing.nameData(i))) == (listing.nameSize(i));
+				names.insert(listing.name(i));
+				if(listing.directory(i))
+					++directories;
+			}
+			++pages;
+		}
+		[[Check::Verify]] (names.size()) == 251u;
+		[[Check::Verify]] directories == 1u;
+		[[Check::Verify]] (pages >= 3u) == true;
+
+		listing.rewind();
+		[[Check::NoThrow]] driver->listDirectory(path, listing, 0, Tial::VFS::NamePattern("file1*"));
+		[[Check::Verify]] (listing.size()) == 111u;
+		[[Check::Verify]] (listing.complete()) == true;
+
+		[[Check::NoThrow]] directory->remove();
+	}
+
 	static void driverTestInvalidateOnParentRemoval(MountPointWrapper root) {
 		//check invalidation on parent directory removal
 		auto asia1 = [[Check::NoThrow]] root->createDirectory("Asia");
@@ -795,6 +1010,385 @@ class [[Testing::CaseBase]] VFS {
 		root->get<Tial::VFS::File>("file")->remove();
 	}
 
+	static void driverTestReadOnlyMappings(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("file");
+		file->open() << "shared table";
+
+		// readers hold their mappings at the same time
+		std::atomic<int> holding(0);
+		std::atomic<int> peak(0);
+		auto reader = [&]() {
+			auto map = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+			int now = ++holding;
+			peak = std::max(peak.load(), now);
+			for(int i = 0; i < 1000 && holding < 3; ++i)
+				std::this_thread::sleep_for(1ms);
+			[[Check::Verify]] (std::string(map.as<char>(), map.size())) == "shared table";
+			std::this_thread::sleep_for(10ms);
+			--holding;
+		};
+		Testing::Thread first(reader), second(reader), third(reader);
+		first("first");
+		second("second");
+		third("third");
+		first.join();
+		second.join();
+		third.join();
+		[[Check::Verify]] (peak.load()) == 3;
+
+		{
+			auto map = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+			[[Check::Verify]] (map.access() == Tial::VFS::Mapping::Access::ReadOnly);
+			[[Check::Throw(Exceptions::ReadOnlyAccessor)]] map.resize(1);
+			[[Check::Throw(Exceptions::ReadOnlyAccessor)]] map.reserve(1024);
+
+			// writer waits until readers are gone
+			std::atomic<bool> written(false);
+			Testing::Thread writer([&]() {
+				auto map = [[Check::NoThrow]] file->map();
+				written = true;
+				[[Check::NoThrow]] map.resize(6);
+			});
+			writer("writer");
+			std::this_thread::sleep_for(20ms);
+			[[Check::Verify]] (written.load()) == false;
+			[[Check::Verify]] (map.size()) == 12u;
+
+			// new readers wait behind the writer, ones reading already do not
+			std::atomic<bool> lateMapped(false);
+			Testing::Thread late([&]() {
+				auto map = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+				lateMapped = true;
+				[[Check::Verify]] (written.load()) == true;
+				[[Check::Verify]] (map.size()) == 6u;
+			});
+			late("late reader");
+			std::this_thread::sleep_for(20ms);
+			[[Check::Verify]] (lateMapped.load()) == false;
+			{
+				auto again = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+				[[Check::Verify]] (again.size()) == 12u;
+			}
+
+			map = Tial::VFS::Mapping();
+			writer.join();
+			late.join();
+			[[Check::Verify]] (written.load()) == true;
+			[[Check::Verify]] (lateMapped.load()) == true;
+		}
+		verifyFileContent(file, "shared");
+
+		// read-only mapping cannot turn writable, neither for the file to be resized
+		{
+			auto map = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+			[[Check::Throw(Exceptions::MappingUpgrade)]] file->map();
+			[[Check::Throw(Exceptions::MappingUpgrade)]] file->resize(3);
+			[[Check::Verify]] (std::string(map.as<char>(), map.size())) == "shared";
+		}
+
+		// resizing waits until readers of other threads are gone
+		{
+			std::promise<void> mapped;
+			std::atomic<bool> released(false);
+			Testing::Thread reader([&]() {
+				auto map = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+				mapped.set_value();
+				std::this_thread::sleep_for(20ms);
+				[[Check::Verify]] (std::string(map.as<char>(), map.size())) == "shared";
+				released = true;
+			});
+			reader("reader");
+			mapped.get_future().wait();
+			[[Check::NoThrow]] file->resize(8);
+			[[Check::Verify]] (released.load()) == true;
+			reader.join();
+			[[Check::NoThrow]] file->resize(6);
+		}
+
+		// thread holding writable mapping can still read
+		{
+			auto map = [[Check::NoThrow]] file->map();
+			auto view = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+			[[Check::Verify]] (std::string(view.as<char>(), view.size())) == "shared";
+		}
+
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestWindows(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("large");
+		std::string content;
+		for(size_t i = 0; content.size() < 20000; ++i)
+			content += std::to_string(i) + ",";
+		file->open().write(content.data(), content.size());
+
+		// windows at unaligned offsets, crossing page boundaries, coexisting
+		auto first = [[Check::NoThrow]] file->map(4090, 100);
+		auto second = [[Check::NoThrow]] file->map(10000, 300, Tial::VFS::Mapping::Access::ReadOnly);
+		[[Check::Verify]] (first.size()) == 100u;
+		[[Check::Verify]] (std::string(first.as<char>(), first.size())) == content.substr(4090, 100);
+		[[Check::Verify]] (std::string(second.as<char>(), second.size())) == content.substr(10000, 300);
+		std::memcpy(first.as<char>(), "window", 6);
+		content.replace(4090, 6, "window");
+
+		// sliding through the whole file
+		std::string read;
+		auto sliding = [[Check::NoThrow]] file->map(0, 5000, Tial::VFS::Mapping::Access::ReadOnly);
+		do
+			read += std::string(sliding.as<char>(), sliding.size());
+		while(sliding.next());
+		[[Check::Verify]] read == content;
+
+		char *position = static_cast<char*>([[Check::NoThrow]] sliding.at(12345, 10));
+		[[Check::Verify]] (std::string(position, 10)) == content.substr(12345, 10);
+		[[Check::Verify]] (sliding.contains(12345, 10)) == true;
+		[[Check::Throw(Exception)]] sliding.at(0, 5001);
+
+		// resized file, windows see only what is left of it, and what was added
+		[[Check::NoThrow]] file->resize(10100);
+		[[Check::Verify]] (second.size()) == 100u;
+		[[Check::Verify]] (std::string(second.as<char>(), second.size())) == content.substr(10000, 100);
+		[[Check::NoThrow]] file->resize(content.size());
+		[[Check::Verify]] (second.size()) == 300u;
+		[[Check::Verify]] (std::string(second.as<char>()+100, 200)) == std::string(200, '\0');
+		[[Check::Verify]] (first.size()) == 100u;
+		[[Check::Verify]] (std::string(first.as<char>(), 6)) == "window";
+
+		first = Tial::VFS::Window();
+		second = Tial::VFS::Window();
+		sliding = Tial::VFS::Window();
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestAdvice(MountPointWrapper root) {
+		typedef Tial::VFS::Driver::Advice Advice;
+		auto file = [[Check::NoThrow]] root->createFile("advised");
+		std::string content(3*4096 + 100, 'x');
+		for(size_t i = 0; i < content.size(); i += 7)
+			content[i] = 'a' + i % 26;
+		file->open().write(content.data(), content.size());
+
+		// hints never change contents, whatever the driver does with them
+		for(auto advice: {Advice::Sequential, Advice::Random, Advice::WillNeed, Advice::DontNeed,
+				Advice::HugePage, Advice::Normal}) {
+			[[Check::NoThrow]] file->advise(advice);
+			[[Check::NoThrow]] file->advise(advice, 4096, 100);
+
+			auto stream = [[Check::NoThrow]] file->open();
+			[[Check::NoThrow]] stream.advise(advice);
+			std::vector<char> data(content.size());
+			stream.read(data.data(), data.size());
+			[[Check::Verify]] (std::string(data.begin(), data.end())) == content;
+
+			auto mapping = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly, true);
+			[[Check::NoThrow]] mapping.advise(advice);
+			[[Check::NoThrow]] mapping.advise(advice, 5000, 10);
+			[[Check::NoThrow]] mapping.advise(advice, content.size()+1);
+			[[Check::Verify]] (std::string(mapping.as<char>(), mapping.size())) == content;
+
+			auto window = [[Check::NoThrow]] file->map(4000, 200, Tial::VFS::Mapping::Access::ReadOnly, true);
+			[[Check::NoThrow]] window.advise(advice);
+			[[Check::Verify]] (std::string(window.as<char>(), window.size())) == content.substr(4000, 200);
+		}
+
+		// data written before dropping pages is kept
+		{
+			auto mapping = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadWrite, true);
+			mapping.as<char>()[10] = '!';
+			[[Check::NoThrow]] mapping.advise(Advice::DontNeed);
+			[[Check::Verify]] (mapping.as<char>()[10]) == '!';
+		}
+
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestDurability(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("log");
+		{
+			auto mapping = [[Check::NoThrow]] file->map();
+			[[Check::NoThrow]] mapping.resize(3*4096);
+			std::memset(mapping.get(), 'm', mapping.size());
+			[[Check::NoThrow]] mapping.flush(4000, 200);
+			[[Check::NoThrow]] mapping.flush(0, 0, true);
+			[[Check::NoThrow]] mapping.flush(5*4096);
+		}
+		{
+			auto window = [[Check::NoThrow]] file->map(4096, 100);
+			std::memcpy(window.get(), "window", 6);
+			[[Check::NoThrow]] window.flush();
+		}
+		[[Check::NoThrow]] file->sync();
+
+		// writers of many threads share syncs
+		const size_t threads = 8, records = 50;
+		[[Check::NoThrow]] file->resize(3*4096 + threads*records*4);
+		std::mutex writing;
+		{
+			Tial::VFS::GroupCommit commit(file);
+			std::vector<std::unique_ptr<Testing::Thread>> writers;
+			for(size_t t = 0; t < threads; ++t) {
+				writers.emplace_back(new Testing::Thread([&, t]() {
+					auto stream = file->open();
+					for(size_t i = 0; i < records; ++i) {
+						std::unique_lock<std::mutex> lock(writing);
+						stream.seekp(3*4096 + (t*records + i)*4);
+						stream << std::setw(4) << (t*records + i);
+						stream.flush();
+						lock.unlock();
+						[[Check::NoThrow]] commit.sync();
+					}
+				}));
+				(*writers.back())("writer");
+			}
+			for(auto &writer: writers)
+				writer->join();
+			[[Check::Verify]] (commit.requests()) == threads*records;
+			[[Check::Verify]] (commit.batches() <= commit.requests()) == true;
+			[[Check::NoThrow]] commit.syncAsync().get();
+		}
+
+		// requests made while a sync is in progress are merged into the next one
+		{
+			std::promise<void> entered, proceed;
+			auto gate = proceed.get_future().share();
+			bool first = true;
+			Tial::VFS::GroupCommit commit([&]() {
+				if(first) {
+					first = false;
+					entered.set_value();
+					gate.wait();
+				}
+				file->sync();
+			});
+			auto blocked = [[Check::NoThrow]] commit.syncAsync();
+			entered.get_future().wait();
+			std::vector<Tial::VFS::Task<void>> queued;
+			for(size_t i = 0; i < 10; ++i)
+				queued.push_back(commit.syncAsync());
+			proceed.set_value();
+			[[Check::NoThrow]] blocked.get();
+			for(auto &task: queued)
+				[[Check::NoThrow]] task.get();
+			[[Check::Verify]] (commit.requests()) == 11u;
+			[[Check::Verify]] (commit.batches()) == 2u;
+		}
+
+		auto mapping = [[Check::NoThrow]] file->map(Tial::VFS::Mapping::Access::ReadOnly);
+		[[Check::Verify]] (mapping.size()) == 3*4096 + threads*records*4;
+		[[Check::Verify]] (std::string(mapping.as<char>()+4096, 7)) == "windowm";
+		for(size_t i = 0; i < threads*records; i += 37)
+			[[Check::Verify]] (std::stoul(std::string(mapping.as<char>()+3*4096+i*4, 4))) == i;
+		mapping = Tial::VFS::Mapping();
+
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestHandles(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("handled");
+		auto handle = [[Check::NoThrow]] file->handle();
+		[[Check::Verify]] handle.assigned();
+
+		std::string first = "positional ", second = "access";
+		[[Check::Verify]] (handle.write(0, {first.data(), first.size()})) == first.size();
+		[[Check::Verify]] (file->write(first.size(), {second.data(), second.size()})) == second.size();
+		[[Check::Verify]] (file->size()) == first.size() + second.size();
+		[[Check::Verify]] (handle.size()) == first.size() + second.size();
+
+		std::vector<char> a(4), b(100);
+		[[Check::Verify]] (handle.read(7, std::vector<Tial::VFS::Driver::Buffer>{{a.data(), a.size()},
+			{b.data(), b.size()}})) == 10u;
+		[[Check::Verify]] (std::string(a.data(), 4) + std::string(b.data(), 6)) == "nal access";
+		[[Check::Verify]] (file->read(11, {b.data(), b.size()})) == 6u;
+		[[Check::Verify]] (file->read(100, {b.data(), b.size()})) == 0u;
+
+		// copies share the descriptor, threads read through it at own positions
+		std::string expected = first + second;
+		std::atomic<size_t> mismatches(0);
+		std::vector<std::unique_ptr<Testing::Thread>> readers;
+		for(size_t t = 0; t < 4; ++t) {
+			readers.emplace_back(new Testing::Thread([handle, t, &expected, &mismatches]() {
+				for(size_t i = 0; i < 100; ++i) {
+					size_t pos = (t*7 + i) % expected.size();
+					char c = 0;
+					if(handle.read(pos, {&c, 1}) != 1 || c != expected[pos])
+						++mismatches;
+				}
+			}));
+			(*readers.back())("reader");
+		}
+		for(auto &reader: readers)
+			reader->join();
+		[[Check::Verify]] (mismatches.load()) == 0u;
+
+		// streams with buffers of their own size
+		for(size_t bufferSize: {1u, 7u, 1024u*1024u}) {
+			auto stream = [[Check::NoThrow]] file->open(0, std::ios_base::beg, bufferSize);
+			[[Check::Verify]] (stream.bufferSize()) == bufferSize;
+			std::string read;
+			std::getline(stream, read);
+			[[Check::Verify]] read == expected;
+			auto copy = stream;
+			[[Check::Verify]] (copy.bufferSize()) == bufferSize;
+		}
+
+		handle = Tial::VFS::Handle();
+		[[Check::Throw(Exceptions::UnassignedAccessor)]] handle.size();
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestViews(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("viewed");
+		std::string content = "borrowed bytes";
+		[[Check::Verify]] (file->write(0, {content.data(), content.size()})) == content.size();
+
+		auto view = [[Check::NoThrow]] file->view(2, 6);
+		[[Check::Verify]] (std::string(view.begin(), view.end())) == "rrowed";
+		[[Check::Verify]] (std::string(view.as<char>(), view.size())) == "rrowed";
+		[[Check::Verify]] (file->view(9, 100).size()) == 5u;
+		[[Check::Verify]] (file->view(content.size(), 10).empty());
+		[[Check::Verify]] (file->view(1000, 10).empty());
+
+		// long enough to be lent by drivers that copy short ranges
+		std::vector<char> large(256*1024);
+		for(size_t i = 0; i < large.size(); ++i)
+			large[i] = static_cast<char>('a' + i % 26);
+		[[Check::Verify]] (file->write(0, {large.data(), large.size()})) == large.size();
+		auto whole = [[Check::NoThrow]] file->view(0, large.size());
+		[[Check::Verify]] (whole.size()) == large.size();
+		[[Check::Verify]] (std::equal(large.begin(), large.end(), whole.begin()));
+
+		// bytes stay pinned while the file grows and after it is gone
+		auto copy = whole;
+		[[Check::Verify]] (copy.data()) == whole.data();
+		whole = Tial::VFS::View();
+		[[Check::Verify]] (whole.empty());
+		[[Check::NoThrow]] file->resize(4*large.size());
+		if(std::dynamic_pointer_cast<Tial::VFS::NativeFSDriver>(root.driver())) {
+			// mapped view is not shrunk under its user
+			auto shrink = [&file]() { file->resize(10); };
+			[[Check::Throw(Exceptions::FileViewed)]] shrink();
+		}
+		[[Check::NoThrow]] file->resize(large.size());
+		[[Check::NoThrow]] file->remove();
+		[[Check::Verify]] (std::equal(large.begin(), large.end(), copy.begin()));
+		[[Check::Verify]] (std::string(view.begin(), view.end())) == "rrowed";
+
+		// views do not move a mapping resized within its capacity
+		auto mapped = [[Check::NoThrow]] root->createFile("viewed mapping");
+		{
+			auto mapping = [[Check::NoThrow]] mapped->map();
+			[[Check::NoThrow]] mapping.resize(content.size());
+			std::memcpy(mapping.get(), content.data(), content.size());
+			[[Check::NoThrow]] mapping.reserve(1024*1024);
+			void *address = mapping.get();
+			auto pinned = [[Check::NoThrow]] mapped->view(0, content.size());
+			[[Check::NoThrow]] mapping.resize(512*1024);
+			[[Check::Verify]] (mapping.get()) == address;
+			[[Check::Verify]] (std::string(pinned.begin(), pinned.end())) == content;
+		}
+		[[Check::NoThrow]] mapped->remove();
+	}
+
 	static void driverTestMutlipleStreamsMappings(MountPointWrapper root) {
 		auto file = [[Check::NoThrow]] root->createFile("file");
 		auto stream1 = [[Check::NoThrow]] file->open();
@@ -895,6 +1489,707 @@ class [[Testing::CaseBase]] VFS {
 		_driverTestListRemoveSample(root.get());
 	}
 
+	static void driverTestLookupCache(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createDirectory("a")->createDirectory("b")->createFile("c");
+		auto &cache = root.root()->lookupCache();
+
+		auto before = [[Check::NoThrow]] cache.statistics();
+		auto first = [[Check::NoThrow]] root->get<Tial::VFS::File>("a/b/c");
+		auto second = [[Check::NoThrow]] root->get<Tial::VFS::File>("a/b/c");
+		auto after = [[Check::NoThrow]] cache.statistics();
+		[[Check::Verify]] first == file;
+		[[Check::Verify]] second == file;
+		[[Check::Verify]] (after.misses) == (before.misses+1);
+		[[Check::Verify]] (after.hits) == (before.hits+1);
+
+		// removal invalidates cached lookups
+		[[Check::NoThrow]] root->get<Tial::VFS::Directory>("a")->remove();
+		[[Check::Throw(Exceptions::ElementNotFound)]] root->get<Tial::VFS::File>("a/b/c");
+		[[Check::Verify]] (file->valid()) == Tial::VFS::Object::Validity::Broken;
+	}
+
+	static void driverTestTryGet(MountPointWrapper root) {
+		auto &cache = root.root()->lookupCache();
+		auto directory = [[Check::NoThrow]] root->createDirectory("a");
+
+		[[Check::Verify]] (root->tryGet<Tial::VFS::File>("a/b")) == nullptr;
+		[[Check::Verify]] (root->exists("a/b")) == false;
+		[[Check::Verify]] (root->exists("a/b/c")) == false;
+		[[Check::Verify]] (root->exists("a")) == true;
+		[[Check::Verify]] (root->tryGet<Tial::VFS::Directory>("a")) == directory;
+		// wrong type is not an error either
+		[[Check::Verify]] (root->tryGet<Tial::VFS::File>("a")) == nullptr;
+
+		// repeated misses are answered from negative cache
+		auto before = [[Check::NoThrow]] cache.statistics();
+		[[Check::Verify]] (root->exists("a/b")) == false;
+		auto after = [[Check::NoThrow]] cache.statistics();
+		[[Check::Verify]] (after.negativeHits) == (before.negativeHits+1);
+		[[Check::Verify]] (after.misses) == (before.misses);
+
+		// creation makes negative entries stale
+		auto file = [[Check::NoThrow]] directory->createFile("b");
+		[[Check::Verify]] (root->tryGet<Tial::VFS::File>("a/b")) == file;
+		[[Check::Verify]] (root->exists("a/b")) == true;
+
+		// get() still tells why, even if the miss is cached
+		[[Check::Verify]] (root->exists("a/b/c")) == false;
+		[[Check::Throw(Exceptions::ElementKindInvalid)]] root->get<Tial::VFS::File>("a/b/c");
+		std::string message;
+		try {
+			root->get<Tial::VFS::File>("a/c/d");
+		} catch(const Exceptions::ElementNotFound &e) {
+			message = e.what();
+		}
+		[[Check::Verify]] (message.find("c/d") != std::string::npos) == true;
+		[[Check::Verify]] (message.find(std::string(directory->path())) != std::string::npos) == true;
+
+		[[Check::NoThrow]] file->remove();
+		[[Check::Verify]] (root->exists("a/b")) == false;
+		[[Check::Throw(Exceptions::ElementNotFound)]] root->get<Tial::VFS::File>("a/b");
+		[[Check::NoThrow]] directory->remove();
+
+		auto driver = std::make_shared<Tial::VFS::MemoryDriver>();
+		[[Check::NoThrow]] driver->createDirectory("/x");
+		[[Check::Verify]] (driver->exists("/x")) == true;
+		[[Check::Verify]] (driver->exists("/y")) == false;
+		[[Check::Verify]] (driver->exists("/x/y/z")) == false;
+		[[Check::Verify]] (driver->tryGet("/x")->directory) == true;
+		[[Check::Throw(Exceptions::ElementNotFound)]] driver->get("/y");
+	}
+
+	static void driverTestAttributes(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("file");
+		[[Check::Verify]] (file->size()) == 0u;
+
+		// cached size follows writes done through streams and mappings
+		file->open() << "what is that...";
+		[[Check::Verify]] (file->size()) == 15u;
+		{
+			auto mapping = [[Check::NoThrow]] file->map();
+			[[Check::NoThrow]] mapping.resize(20);
+		}
+		[[Check::Verify]] (file->size()) == 20u;
+		[[Check::NoThrow]] file->resize(4);
+		[[Check::Verify]] (file->size()) == 4u;
+
+		auto attributes = [[Check::NoThrow]] file->attributes();
+		[[Check::Verify]] (attributes.kind == Tial::VFS::Driver::Attributes::Kind::File) == true;
+		[[Check::Verify]] (attributes.complete()) == true;
+		[[Check::Verify]] (*attributes.size) == 4u;
+
+		// driver reports the same, identity differs between files
+		auto entry = [[Check::NoThrow]] root.driver()->get("/file");
+		[[Check::Verify]] (entry.attributes.kind == Tial::VFS::Driver::Attributes::Kind::File) == true;
+		[[Check::Verify]] (*entry.attributes.size) == 4u;
+		[[Check::Verify]] (entry.attributes.identity == attributes.identity) == true;
+		auto other = [[Check::NoThrow]] root->createFile("other");
+		[[Check::Verify]] (other->attributes().identity != attributes.identity) == true;
+
+		[[Check::NoThrow]] other->remove();
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestDeepPaths(MountPointWrapper root) {
+		std::shared_ptr<Tial::VFS::Directory> directory = root.get();
+		for(auto name: {"a", "b", "c", "d"})
+			directory = [[Check::NoThrow]] directory->createDirectory(name);
+		directory->createFile("file")->open() << "deep";
+		verifyFileContent(root->get<Tial::VFS::File>("a/b/c/d/file"), "deep");
+
+		// same names created again must not reach directories removed before
+		[[Check::NoThrow]] root->get<Tial::VFS::File>("a/b/c/d/file")->remove();
+		[[Check::NoThrow]] root->get<Tial::VFS::Directory>("a/b/c/d")->remove();
+		[[Check::NoThrow]] root->get<Tial::VFS::Directory>("a/b/c")->remove();
+		directory = [[Check::NoThrow]] root->get<Tial::VFS::Directory>("a/b")->createDirectory("c");
+		directory = [[Check::NoThrow]] directory->createDirectory("d");
+		directory->createFile("file")->open() << "deeper";
+		verifyFileContent(root->get<Tial::VFS::File>("a/b/c/d/file"), "deeper");
+		[[Check::Verify]] (root.driver()->size("/a/b/c/d/file")) == 6u;
+		[[Check::Verify]] (root.driver()->listDirectory("/a/b/c/d").size()) == 1u;
+
+		[[Check::NoThrow]] root->get<Tial::VFS::File>("a/b/c/d/file")->remove();
+		for(auto path: {"a/b/c/d", "a/b/c", "a/b", "a"})
+			[[Check::NoThrow]] root->get<Tial::VFS::Directory>(path)->remove();
+	}
+
+	static void driverTestGrowableMapping(MountPointWrapper root) {
+		auto file = [[Check::NoThrow]] root->createFile("growing");
+		std::string expected;
+		{
+			auto mapping = [[Check::NoThrow]] file->map();
+			[[Check::NoThrow]] mapping.reserve(1024*1024);
+			[[Check::Verify]] (mapping.capacity() >= 1024*1024) == true;
+
+			// appends within reservation keep data where it was
+			void *address = mapping.get();
+			for(size_t i = 0; i < 1000; ++i) {
+				std::string record = "record " + std::to_string(i) + "\n";
+				size_t size = mapping.size();
+				[[Check::NoThrow]] mapping.resize(size + record.size());
+				std::memcpy(mapping.as<char>() + size, record.data(), record.size());
+				expected += record;
+			}
+			[[Check::Verify]] (mapping.get()) == address;
+
+			// shrinking and growing again, also through the file
+			[[Check::NoThrow]] mapping.resize(10);
+			[[Check::NoThrow]] file->resize(expected.size());
+			[[Check::Verify]] (mapping.get()) == address;
+			[[Check::Verify]] (mapping.size()) == expected.size();
+			std::memcpy(mapping.as<char>() + 10, expected.data() + 10, expected.size() - 10);
+
+			// growing out of reservation keeps contents
+			[[Check::NoThrow]] mapping.resize(2*1024*1024);
+			[[Check::Verify]] (std::string(mapping.as<char>(), expected.size())) == expected;
+			[[Check::NoThrow]] mapping.resize(expected.size());
+		}
+		verifyFileContent(file, expected);
+		[[Check::NoThrow]] file->remove();
+	}
+
+	static void driverTestDescriptorCache(MountPointWrapper root) {
+		auto driver = std::dynamic_pointer_cast<Tial::VFS::NativeFSDriver>(root.driver());
+		if(!driver)
+			return;
+
+		auto directory = [[Check::NoThrow]] root->createDirectory("descriptors");
+		for(size_t i = 0; i < 10; ++i)
+			directory->createFile(std::to_string(i))->open() << "file " << i;
+		[[Check::NoThrow]] driver->setDescriptorCacheCapacity(4);
+
+		// files opened again are served from the idle list, the oldest ones get closed
+		auto before = driver->descriptorCacheStatistics();
+		for(size_t round = 0; round < 2; ++round)
+			for(size_t i = 0; i < 10; ++i)
+				verifyFileContent(directory->get<Tial::VFS::File>(std::to_string(i)), "file " + std::to_string(i));
+		auto after = driver->descriptorCacheStatistics();
+		[[Check::Verify]] (after.evictions - before.evictions >= 10) == true;
+
+		// stream and mapping of each of the last two files are still open
+		for(size_t i = 8; i < 10; ++i)
+			verifyFileContent(directory->get<Tial::VFS::File>(std::to_string(i)), "file " + std::to_string(i));
+		[[Check::Verify]] (driver->descriptorCacheStatistics().misses) == after.misses;
+
+		// descriptor in use is shared, and survives going idle across resize and mapping
+		auto file = directory->get<Tial::VFS::File>("9");
+		auto stream = file->open();
+		[[Check::NoThrow]] file->resize(3);
+		{
+			auto mapping = [[Check::NoThrow]] file->map();
+			[[Check::Verify]] (std::string(mapping.as<char>(), mapping.size())) == "fil";
+		}
+		stream.close();
+
+		// file created again under the same name is not read through an idle descriptor
+		[[Check::NoThrow]] file->remove();
+		directory->createFile("9")->open() << "new";
+		verifyFileContent(directory->get<Tial::VFS::File>("9"), "new");
+
+		// nor through one of a file replaced behind the driver
+		[[Check::Verify]] (driver->open("/descriptors/8")->size()) == 6u;
+		[[Check::NoThrow]] driver->createFile("/descriptors/replacement");
+		[[Check::NoThrow]] driver->open("/descriptors/replacement")->write(0, "replaced", 8);
+		[[Check::Verify]] (std::rename("testspace/descriptors/replacement", "testspace/descriptors/8")) == 0;
+		[[Check::Verify]] (driver->open("/descriptors/8")->size()) == 8u;
+
+		// idle descriptors do not keep their driver alive
+		std::weak_ptr<Tial::VFS::NativeFSDriver> released;
+		{
+			auto other = std::make_shared<Tial::VFS::NativeFSDriver>(
+				Tial::Utility::NativeDirectory::current().path()/"testspace");
+			[[Check::Verify]] (other->open("/descriptors/0")->size()) == 6u;
+			released = other;
+		}
+		[[Check::Verify]] (released.expired()) == true;
+
+		[[Check::NoThrow]] driver->setDescriptorCacheCapacity(0);
+		[[Check::NoThrow]] directory->remove();
+		[[Check::NoThrow]] driver->setDescriptorCacheCapacity(64);
+	}
+
+	static void driverTestStaleDirectories(MountPointWrapper root) {
+		auto driver = std::dynamic_pointer_cast<Tial::VFS::NativeFSDriver>(root.driver());
+		if(!driver)
+			return;
+		// same tree changed behind the driver
+		auto other = std::make_shared<Tial::VFS::NativeFSDriver>(
+			Tial::Utility::NativeDirectory::current().path()/"testspace");
+		auto write = [](Tial::VFS::Driver &driver, const Tial::VFS::Path &path, const std::string &content) {
+			driver.createFile(path);
+			driver.open(path)->write(0, content.data(), content.size());
+		};
+
+		[[Check::NoThrow]] driver->createDirectory("/stale");
+		[[Check::NoThrow]] driver->createDirectory("/stale/a");
+		[[Check::NoThrow]] write(*driver, "/stale/a/file", "one");
+		[[Check::Verify]] (driver->size("/stale/a/file")) == 3u;
+
+		// missing elements do not drop the cache
+		auto before = driver->directoryCacheStatistics();
+		for(size_t i = 0; i < 3; ++i)
+			[[Check::Verify]] (driver->exists("/stale/a/missing")) == false;
+		[[Check::Verify]] (driver->size("/stale/a/file")) == 3u;
+		[[Check::Verify]] (driver->directoryCacheStatistics().misses) == before.misses;
+
+		// removed and created again
+		[[Check::NoThrow]] other->removeFile("/stale/a/file");
+		[[Check::NoThrow]] other->removeDirectory("/stale/a");
+		[[Check::NoThrow]] other->createDirectory("/stale/a");
+		[[Check::NoThrow]] write(*other, "/stale/a/file", "second");
+		[[Check::Verify]] (driver->size("/stale/a/file")) == 6u;
+
+		// renamed away and created again
+		[[Check::Verify]] (std::rename("testspace/stale/a", "testspace/stale/old")) == 0;
+		[[Check::NoThrow]] other->createDirectory("/stale/a");
+		[[Check::NoThrow]] write(*other, "/stale/a/new", "third");
+		[[Check::Verify]] (driver->size("/stale/a/new")) == 5u;
+
+		// renamed away with a cached subdirectory, changes go to directories now at the path
+		[[Check::NoThrow]] driver->createDirectory("/stale/a/b");
+		[[Check::NoThrow]] write(*driver, "/stale/a/b/file", "four");
+		[[Check::Verify]] (driver->size("/stale/a/b/file")) == 4u;
+		[[Check::Verify]] (std::rename("testspace/stale/a", "testspace/stale/older")) == 0;
+		[[Check::NoThrow]] other->createDirectory("/stale/a");
+		[[Check::NoThrow]] other->createDirectory("/stale/a/b");
+		[[Check::NoThrow]] driver->createFile("/stale/a/b/created");
+		[[Check::Verify]] (other->exists("/stale/a/b/created")) == true;
+		[[Check::Verify]] (other->exists("/stale/older/b/created")) == false;
+
+		for(auto path: {"/stale/a/b/created", "/stale/older/b/file", "/stale/older/new", "/stale/old/file"})
+			[[Check::NoThrow]] driver->removeFile(path);
+		for(auto path: {"/stale/a/b", "/stale/a", "/stale/older/b", "/stale/older", "/stale/old", "/stale"})
+			[[Check::NoThrow]] driver->removeDirectory(path);
+	}
+
+	static void driverTestScanners(MountPointWrapper root) {
+		auto driver = std::dynamic_pointer_cast<Tial::VFS::NativeFSDriver>(root.driver());
+		if(!driver)
+			return;
+
+		auto directory = [[Check::NoThrow]] root->createDirectory("scanned");
+		for(size_t i = 0; i < 100; ++i)
+			[[Check::NoThrow]] directory->createFile("file" + std::to_string(i));
+		[[Check::NoThrow]] directory->createDirectory("directory");
+
+		// both scanners page through the same entries
+		auto list = [&driver](Tial::VFS::NativeFSDriver::Scanner scanner) {
+			driver->setScanner(scanner);
+			std::vector<std::pair<std::string, bool>> entries;
+			Tial::VFS::Driver::Listing listing;
+			while(!listing.complete()) {
+				driver->listDirectory("/scanned", listing, 7);
+				for(size_t i = 0; i < listing.size(); ++i)
+					entries.emplace_back(listing.name(i), listing.directory(i));
+			}
+			std::sort(entries.begin(), entries.end());
+			return entries;
+		};
+		auto read = [[Check::NoThrow]] list(Tial::VFS::NativeFSDriver::Scanner::ReadDir);
+		auto scanned = [[Check::NoThrow]] list(Tial::VFS::NativeFSDriver::Scanner::GetDents);
+		[[Check::Verify]] (read.size()) == 101u;
+		[[Check::Verify]] (read == scanned) == true;
+		[[Check::Verify]] (std::count(read.begin(), read.end(), std::make_pair(std::string("directory"), true))) == 1;
+
+		// listing is continued by the scanner that started it
+		driver->setScanner(Tial::VFS::NativeFSDriver::Scanner::ReadDir);
+		Tial::VFS::Driver::Listing listing;
+		[[Check::NoThrow]] driver->listDirectory("/scanned", listing, 7);
+		size_t listed = listing.size();
+		driver->setScanner(Tial::VFS::NativeFSDriver::Scanner::GetDents);
+		while(!listing.complete()) {
+			[[Check::NoThrow]] driver->listDirectory("/scanned", listing, 7);
+			listed += listing.size();
+		}
+		[[Check::Verify]] listed == 101u;
+
+		[[Check::NoThrow]] directory->remove();
+	}
+
+	static void driverTestVectoredIO(MountPointWrapper root) {
+		[[Check::NoThrow]] root->createFile("file");
+		auto file = [[Check::NoThrow]] root.driver()->open("/file");
+
+		std::string what = "what ", is = "is ", that = "that...";
+		std::vector<Tial::VFS::Driver::ConstBuffer> output{
+			{what.data(), what.size()}, {is.data(), is.size()}, {nullptr, 0}, {that.data(), that.size()}
+		};
+		[[Check::Verify]] (file->writev(0, output)) == 15u;
+		[[Check::Verify]] (file->size()) == 15u;
+
+		// read across buffer boundaries, last one is filled only partially
+		std::vector<char> first(4), second(8), third(16);
+		std::vector<Tial::VFS::Driver::Buffer> input{
+			{first.data(), first.size()}, {second.data(), second.size()}, {third.data(), third.size()}
+		};
+		[[Check::Verify]] (file->readv(1, input)) == 14u;
+		[[Check::Verify]] (std::string(first.begin(), first.end())) == "hat ";
+		[[Check::Verify]] (std::string(second.begin(), second.end())) == "is that.";
+		[[Check::Verify]] (std::string(third.begin(), third.begin()+2)) == "..";
+
+		// positional writes in the middle and reads past the end
+		[[Check::Verify]] (file->writev(8, {{"this", 4}})) == 4u;
+		[[Check::Verify]] (file->read(15, first.data(), first.size())) == 0u;
+		[[Check::Verify]] (file->readv(20, input)) == 0u;
+		file.reset();
+		verifyFileContent(root->get<Tial::VFS::File>("file"), "what is this...");
+
+		[[Check::NoThrow]] root->get<Tial::VFS::File>("file")->remove();
+	}
+
+	static void driverTestReadMany(MountPointWrapper root) {
+		auto directory = [[Check::NoThrow]] root->createDirectory("batch");
+		std::vector<std::shared_ptr<Tial::VFS::File>> files;
+		for(size_t i = 0; i < 50; ++i) {
+			files.push_back(directory->createFile(std::to_string(i)));
+			files.back()->open() << "content of " << i;
+		}
+
+		// more requests than queue depth, reads at offsets, short reads at end of file
+		[[Check::NoThrow]] root.root()->setQueueDepth(8);
+		std::vector<std::vector<char>> buffers(files.size(), std::vector<char>(32));
+		std::vector<Tial::VFS::Root::ReadRequest> requests(files.size());
+		for(size_t i = 0; i < files.size(); ++i) {
+			requests[i].file = files[i];
+			requests[i].offset = i % 2;
+			requests[i].buffer = {buffers[i].data(), buffers[i].size()};
+		}
+
+		// one file removed behind VFS, one known to be gone
+		[[Check::NoThrow]] root.driver()->removeFile("/batch/7");
+		[[Check::NoThrow]] files[9]->remove();
+
+		[[Check::NoThrow]] root.root()->readMany(requests);
+		for(size_t i = 0; i < files.size(); ++i) {
+			if(i == 7 || i == 9) {
+				[[Check::Verify]] (static_cast<bool>(requests[i].error)) == true;
+				continue;
+			}
+			std::string expected = std::string("content of " + std::to_string(i)).substr(i % 2);
+			[[Check::Verify]] (static_cast<bool>(requests[i].error)) == false;
+			[[Check::Verify]] (std::string(buffers[i].data(), requests[i].transferred)) == expected;
+		}
+
+		[[Check::NoThrow]] root.driver()->createFile("/batch/7");
+		[[Check::NoThrow]] directory->remove();
+	}
+
+	static void driverTestReadManyFailures(MountPointWrapper root) {
+		auto directory = [[Check::NoThrow]] root->createDirectory("failing");
+		auto file = [[Check::NoThrow]] directory->createFile("present");
+		file->open() << "present";
+		auto pool = root.root()->threadPool();
+
+		// nothing of the batch reaches the driver's queue
+		std::vector<std::vector<char>> buffers(6, std::vector<char>(16));
+		std::vector<Tial::VFS::Driver::ReadRequest> failing(3);
+		failing[0].path = "/missing/file";
+		failing[1].path = "/failing/missing/file";
+		failing[2].path = "/failing/present/file";
+		for(size_t i = 0; i < failing.size(); ++i)
+			failing[i].buffer = {buffers[i].data(), buffers[i].size()};
+		[[Check::NoThrow]] root.driver()->readMany(failing, *pool, 2);
+		for(auto &request: failing)
+			[[Check::Verify]] (static_cast<bool>(request.error)) == true;
+
+		// failures mixed with good requests
+		std::vector<Tial::VFS::Driver::ReadRequest> mixed(3);
+		mixed[0].path = "/failing/present";
+		mixed[1].path = "/missing/file";
+		mixed[2].path = "/failing/present";
+		mixed[2].offset = 3;
+		for(size_t i = 0; i < mixed.size(); ++i)
+			mixed[i].buffer = {buffers[3+i].data(), buffers[3+i].size()};
+		[[Check::NoThrow]] root.driver()->readMany(mixed, *pool, 2);
+		[[Check::Verify]] (static_cast<bool>(mixed[0].error)) == false;
+		[[Check::Verify]] (std::string(buffers[3].data(), mixed[0].transferred)) == "present";
+		[[Check::Verify]] (static_cast<bool>(mixed[1].error)) == true;
+		[[Check::Verify]] (static_cast<bool>(mixed[2].error)) == false;
+		[[Check::Verify]] (std::string(buffers[5].data(), mixed[2].transferred)) == "sent";
+
+		// request without file fails alone
+		std::vector<Tial::VFS::Root::ReadRequest> unassigned(2);
+		unassigned[1].file = file;
+		for(size_t i = 0; i < unassigned.size(); ++i)
+			unassigned[i].buffer = {buffers[i].data(), buffers[i].size()};
+		[[Check::NoThrow]] root.root()->readMany(unassigned);
+		[[Check::Verify]] (static_cast<bool>(unassigned[0].error)) == true;
+		[[Check::Verify]] (static_cast<bool>(unassigned[1].error)) == false;
+		[[Check::Verify]] (std::string(buffers[1].data(), unassigned[1].transferred)) == "present";
+
+		// ring kept by the driver serves batches one after another
+		for(size_t round = 0; round < 3; ++round) {
+			[[Check::NoThrow]] root.driver()->readMany(mixed, *pool, 2);
+			[[Check::Verify]] (std::string(buffers[3].data(), mixed[0].transferred)) == "present";
+		}
+
+		[[Check::NoThrow]] directory->remove();
+	}
+
+	static void driverTestAsync(MountPointWrapper root) {
+		auto directory = [[Check::NoThrow]] root->createDirectoryAsync("async").get();
+		auto file = [[Check::NoThrow]] directory->createFileAsync("file").get();
+
+		std::string data = "asynchronous";
+		auto written = [[Check::NoThrow]] file->writeAsync(0, {data.data(), data.size()});
+		[[Check::Verify]] (written.get()) == data.size();
+		[[Check::Verify]] (file->sizeAsync().future().get()) == data.size();
+
+		// continuation runs once the read completed, on whatever thread did it
+		std::vector<char> buffer(32);
+		auto read = [[Check::NoThrow]] file->readAsync(1, {buffer.data(), buffer.size()});
+		std::promise<size_t> transferred;
+		read.then([read, &transferred]() {
+			transferred.set_value(read.get());
+		});
+		[[Check::Verify]] (transferred.get_future().get()) == data.size()-1;
+		[[Check::Verify]] (std::string(buffer.data(), data.size()-1)) == data.substr(1);
+
+		// many transfers in flight at once, reads stop at end of file
+		auto driver = root.driver();
+		auto executor = root.root()->executor();
+		std::vector<std::string> blocks;
+		std::vector<Tial::VFS::Task<size_t>> writes;
+		for(size_t i = 0; i < 64; ++i)
+			blocks.push_back(std::string(1000, static_cast<char>('a' + i % 26)));
+		for(size_t i = 0; i < blocks.size(); ++i)
+			writes.push_back(driver->writeAsync("/async/file", i*1000, {blocks[i].data(), blocks[i].size()}, executor));
+		for(auto &write: writes)
+			[[Check::Verify]] (write.get()) == 1000u;
+		std::vector<char> whole(70000);
+		auto all = [[Check::NoThrow]] driver->readAsync("/async/file", 0, {whole.data(), whole.size()}, executor);
+		[[Check::Verify]] (all.get()) == 64000u;
+		[[Check::Verify]] (whole[63999]) == static_cast<char>('a' + 63 % 26);
+		auto past = [[Check::NoThrow]] driver->readAsync("/async/file", 100000, {whole.data(), whole.size()}, executor);
+		[[Check::Verify]] (past.get()) == 0u;
+		bool missing = false;
+		try {
+			driver->readAsync("/async/missing", 0, {whole.data(), whole.size()}, executor).get();
+		} catch(...) {
+			missing = true;
+		}
+		[[Check::Verify]] missing == true;
+
+		[[Check::NoThrow]] file->resizeAsync(4).get();
+		[[Check::Verify]] (file->size()) == 4;
+		[[Check::Verify]] (directory->contentAsync().get().size()) == 1;
+
+#if defined(__cpp_impl_coroutine)
+		// completed task does not suspend the coroutine, pending one resumes it once it completes
+		Tial::VFS::Promise<size_t> later;
+		std::promise<size_t> sum;
+		awaitSum(Tial::VFS::completed([]() {
+			return size_t(1);
+		}), later.task(), sum);
+		later.setValue(size_t(2));
+		[[Check::Verify]] (sum.get_future().get()) == 3u;
+#endif
+
+		// errors surface when result is taken
+		auto failed = [[Check::NoThrow]] directory->createFileAsync("file");
+		[[Check::Throw(Exceptions::ElementAlreadyExists)]] failed.get();
+
+		[[Check::NoThrow]] file->removeAsync().get();
+		[[Check::NoThrow]] directory->removeAsync().get();
+	}
+
+	static void driverTestWalk(MountPointWrapper root) {
+		auto a = [[Check::NoThrow]] root->createDirectory("a");
+		auto b = [[Check::NoThrow]] a->createDirectory("b");
+		[[Check::NoThrow]] b->createFile("c");
+		[[Check::NoThrow]] a->createFile("d");
+		[[Check::NoThrow]] root->createFile("e");
+
+		size_t count = 0;
+		bool completed = [[Check::NoThrow]] root->forEachChild([&count](const std::shared_ptr<Tial::VFS::Object> &) {
+			++count;
+			return true;
+		});
+		[[Check::Verify]] completed == true;
+		[[Check::Verify]] count == 2u;
+
+		count = 0;
+		completed = [[Check::NoThrow]] root->forEachChild([&count](const std::shared_ptr<Tial::VFS::Object> &) {
+			++count;
+			return false;
+		});
+		[[Check::Verify]] completed == false;
+		[[Check::Verify]] count == 1u;
+
+		for(auto traversal: {Tial::VFS::Directory::Traversal::DepthFirst, Tial::VFS::Directory::Traversal::BreadthFirst}) {
+			std::vector<std::string> names;
+			completed = [[Check::NoThrow]] root->walk([&names](const std::shared_ptr<Tial::VFS::Object> &object) {
+				names.push_back(object->name());
+				return Tial::VFS::Directory::Visit::Continue;
+			}, traversal);
+			[[Check::Verify]] completed == true;
+			[[Check::Verify]] (names.size()) == 5u;
+
+			// parents are always visited before their content
+			auto position = [&names](const std::string &name) {
+				return std::find(names.begin(), names.end(), name)-names.begin();
+			};
+			[[Check::Verify]] (position("a") < position("b")) == true;
+			[[Check::Verify]] (position("b") < position("c")) == true;
+			[[Check::Verify]] (position("a") < position("d")) == true;
+			if(traversal == Tial::VFS::Directory::Traversal::BreadthFirst) {
+				[[Check::Verify]] (position("e") < position("b")) == true;
+				[[Check::Verify]] (position("d") < position("c")) == true;
+			}
+
+			names.clear();
+			[[Check::NoThrow]] root->walk([&names](const std::shared_ptr<Tial::VFS::Object> &object) {
+				names.push_back(object->name());
+				return object->name() == "b" ? Tial::VFS::Directory::Visit::Skip : Tial::VFS::Directory::Visit::Continue;
+			}, traversal);
+			[[Check::Verify]] (names.size()) == 4u;
+			[[Check::Verify]] (std::count(names.begin(), names.end(), "c")) == 0;
+
+			names.clear();
+			completed = [[Check::NoThrow]] root->walk([&names](const std::shared_ptr<Tial::VFS::Object> &object) {
+				names.push_back(object->name());
+				return object->name() == "b" ? Tial::VFS::Directory::Visit::Stop : Tial::VFS::Directory::Visit::Continue;
+			}, traversal);
+			[[Check::Verify]] completed == false;
+			[[Check::Verify]] (names.back()) == "b";
+		}
+
+		[[Check::Verify]] (root->collect().size()) == 5u;
+
+		// elements may be removed while their directory is iterated
+		completed = [[Check::NoThrow]] a->walk([](const std::shared_ptr<Tial::VFS::Object> &object) {
+			if(std::dynamic_pointer_cast<Tial::VFS::File>(object))
+				object->remove();
+			return Tial::VFS::Directory::Visit::Continue;
+		});
+		[[Check::Verify]] completed == true;
+		[[Check::Verify]] (a->collect().size()) == 1u;
+		[[Check::Verify]] (b->content().empty()) == true;
+
+		// lookups see removal at once, iterated content only after iteration ends
+		[[Check::NoThrow]] a->createFile("f");
+		size_t visited = 0;
+		bool seen = true;
+		completed = [[Check::NoThrow]] a->forEachChild([&](const std::shared_ptr<Tial::VFS::Object> &object) {
+			++visited;
+			if(object->name() == "f") {
+				object->remove();
+				seen = a->exists("f") || a->content().size() != 1u;
+			}
+			return true;
+		});
+		[[Check::Verify]] completed == true;
+		[[Check::Verify]] visited == 2u;
+		[[Check::Verify]] seen == false;
+		[[Check::Verify]] (a->content().size()) == 1u;
+		[[Check::NoThrow]] a->remove();
+		[[Check::NoThrow]] root->get<Tial::VFS::File>("e")->remove();
+	}
+
+	static void driverTestParallelWalk(MountPointWrapper root) {
+		auto tree = [[Check::NoThrow]] root->createDirectory("tree");
+		for(int i = 0; i < 10; ++i) {
+			auto directory = [[Check::NoThrow]] tree->createDirectory("d" + std::to_string(i));
+			for(int j = 0; j < 5; ++j)
+				[[Check::NoThrow]] directory->createDirectory("e" + std::to_string(j))->createFile("f");
+		}
+
+		auto sequential = [[Check::NoThrow]] tree->collect();
+		std::sort(sequential.begin(), sequential.end());
+		for(size_t workers: {0u, 1u, 4u}) {
+			[[Check::NoThrow]] root.root()->setWorkerCount(workers);
+			auto parallel = [[Check::NoThrow]] tree->collect(Tial::VFS::Directory::Traversal::Parallel);
+			std::sort(parallel.begin(), parallel.end());
+			[[Check::Verify]] (parallel.size()) == 110u;
+			[[Check::Verify]] parallel == sequential;
+
+			auto files = [[Check::NoThrow]] tree->getAll("**/f", Tial::VFS::Directory::Traversal::Parallel);
+			[[Check::Verify]] (files.size()) == 50u;
+
+			std::atomic<size_t> visited{0};
+			bool completed = [[Check::NoThrow]] tree->walk([&visited](const std::shared_ptr<Tial::VFS::Object> &) {
+				return ++visited == 3 ? Tial::VFS::Directory::Visit::Stop : Tial::VFS::Directory::Visit::Continue;
+			}, Tial::VFS::Directory::Traversal::Parallel);
+			[[Check::Verify]] completed == false;
+
+			// failing on the calling thread, once tasks of other directories were spawned
+			std::atomic<size_t> top{0};
+			auto failing = [&top](const std::shared_ptr<Tial::VFS::Object> &object) {
+				if(object->name()[0] == 'd' && ++top == 10)
+					throw Exception("visitor failed");
+				return Tial::VFS::Directory::Visit::Continue;
+			};
+			[[Check::Throw(Exception)]] tree->walk(failing, Tial::VFS::Directory::Traversal::Parallel);
+		}
+
+		[[Check::NoThrow]] tree->remove();
+	}
+
+	static void driverTestGlob(MountPointWrapper root) {
+		auto textures = [[Check::NoThrow]] root->createDirectory("textures");
+		[[Check::NoThrow]] textures->createFile("wall.png");
+		[[Check::NoThrow]] textures->createFile("floor.png");
+		[[Check::NoThrow]] textures->createFile("floor.jpg");
+		auto nested = [[Check::NoThrow]] textures->createDirectory("nested");
+		[[Check::NoThrow]] nested->createFile("sky.png");
+		[[Check::NoThrow]] nested->createDirectory("deep")->createFile("sea.png");
+
+		[[Check::Verify]] (root->getAll("textures/*.png").size()) == 2u;
+		[[Check::Verify]] (root->getAll("textures/f*r.*").size()) == 2u;
+		[[Check::Verify]] (root->getAll("textures/*l*.p?g").size()) == 2u;
+		[[Check::Verify]] (root->getAll("textures/*.PNG").size()) == 2u;
+		[[Check::Verify]] (root->getAll("TEXTURES/wall.png").size()) == 1u;
+		[[Check::Verify]] (root->getAll("textures/missing.png").size()) == 0u;
+		[[Check::Verify]] (root->getAll("**/*.png").size()) == 4u;
+		[[Check::Verify]] (root->getAll("**/sea.png").size()) == 1u;
+		[[Check::Verify]] (root->getAll("textures/**").size()) == 7u;
+
+		// overlapping patterns do not report any element twice
+		[[Check::Verify]] (root->getAll("**/**/*.png").size()) == 2u;
+		[[Check::Verify]] (root->getAll("**/**").size()) == 7u;
+
+		Tial::VFS::Glob glob("**/*.png");
+		[[Check::Verify]] (glob.match(root.get()).size()) == 4u;
+		[[Check::Verify]] (glob.match(root.get(), 2).size()) == 2u;
+		[[Check::Verify]] (glob.match(textures).size()) == 2u;
+		[[Check::Verify]] (glob.first(nested)->name()) == "sea.png";
+		[[Check::Verify]] (Tial::VFS::Glob("**/*.gif").first(root.get())) == nullptr;
+
+		auto file = [[Check::NoThrow]] root->get<Tial::VFS::File>("textures/*.jpg");
+		[[Check::Verify]] (file->name()) == "floor.jpg";
+		[[Check::Throw(Exceptions::ElementNotFound)]] root->get<Tial::VFS::File>("textures/*.gif");
+
+		[[Check::NoThrow]] textures->remove();
+	}
+
+	static void driverTestCaseSensitivity(MountPointWrapper root) {
+		// default mounts fold case of names
+		auto file = [[Check::NoThrow]] root->createFile("Readme");
+		[[Check::Verify]] (root->get<Tial::VFS::File>("README")) == file;
+		[[Check::Verify]] (root->get<Tial::VFS::File>("readme")) == file;
+		[[Check::NoThrow]] file->remove();
+
+		// many entries switch the directory to the hashed layout
+		for(int i = 0; i < 100; ++i)
+			[[Check::NoThrow]] root->createFile("File" + std::to_string(i));
+		[[Check::Verify]] (root->content().size()) == 100u;
+		for(int i = 0; i < 100; ++i)
+			[[Check::Verify]] (root->get<Tial::VFS::File>("FILE" + std::to_string(i))->name()) == "File" + std::to_string(i);
+		for(int i = 0; i < 100; ++i)
+			[[Check::NoThrow]] root->get<Tial::VFS::File>("file" + std::to_string(i))->remove();
+
+		// case sensitive mounts keep names apart
+		[[Check::NoThrow]] root->unmount();
+		[[Check::NoThrow]] root->mount(std::make_shared<Tial::VFS::MemoryDriver>(), true);
+		auto lower = [[Check::NoThrow]] root->createFile("readme");
+		auto upper = [[Check::NoThrow]] root->createFile("README");
+		[[Check::Verify]] lower != upper;
+		[[Check::Verify]] (root->get<Tial::VFS::File>("readme")) == lower;
+		[[Check::Verify]] (root->get<Tial::VFS::File>("README")) == upper;
+		[[Check::Throw(Exceptions::ElementNotFound)]] root->get<Tial::VFS::File>("Readme");
+		[[Check::Verify]] (root->content().size()) == 2u;
+	}
+
 	static void driverTests(std::function<MountPointWrapper()> initFunction) {
 		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, "Tial::Utility::Path");
 		Tial::Utility::Logger::setLoggingLevel(Tial::Utility::Logger::Level::Info, "Tial::Utility::Wildcards");
@@ -905,6 +2200,11 @@ class [[Testing::CaseBase]] VFS {
 		driverTestListByWildcards(initFunction());
 		driverTestInvalidateOnRemove(initFunction());
 		driverTestInvalidateOnDriverRequest(initFunction());
+		driverTestLazyInvalidation(initFunction());
+		driverTestReconciliation(initFunction());
+		driverTestCreateRemoveWithoutListing(initFunction());
+		driverTestFilteredListing(initFunction());
+		driverTestPagedListing(initFunction());
 		driverTestInvalidateOnParentRemoval(initFunction());
 		driverTestInvalidateOnUnmount(initFunction());
 		driverTestOpenWriteRead(initFunction());
@@ -913,9 +2213,31 @@ class [[Testing::CaseBase]] VFS {
 		driverTestMappingFileObject(initFunction());
 		driverTestMultipleStreams(initFunction());
 		driverTestMultipleMappings(initFunction());
+		driverTestReadOnlyMappings(initFunction());
+		driverTestWindows(initFunction());
+		driverTestAdvice(initFunction());
+		driverTestDurability(initFunction());
+		driverTestHandles(initFunction());
+		driverTestViews(initFunction());
 		driverTestMutlipleStreamsMappings(initFunction());
 
 		driverTestComplexStructure(initFunction());
+		driverTestLookupCache(initFunction());
+		driverTestTryGet(initFunction());
+		driverTestAttributes(initFunction());
+		driverTestDeepPaths(initFunction());
+		driverTestGrowableMapping(initFunction());
+		driverTestDescriptorCache(initFunction());
+		driverTestStaleDirectories(initFunction());
+		driverTestScanners(initFunction());
+		driverTestVectoredIO(initFunction());
+		driverTestReadMany(initFunction());
+		driverTestReadManyFailures(initFunction());
+		driverTestAsync(initFunction());
+		driverTestWalk(initFunction());
+		driverTestParallelWalk(initFunction());
+		driverTestGlob(initFunction());
+		driverTestCaseSensitivity(initFunction());
 	}
 
 	template<typename DriverClass, typename... Args>
@@ -927,8 +2249,9 @@ class [[Testing::CaseBase]] VFS {
 			for(auto i: path)
 				dir = dir->createDirectory(i);
 		}
-		[[Check::NoThrow]] dir->mount(std::make_shared<DriverClass>(std::forward<Args>(args)...));
-		return MountPointWrapper(root, dir);
+		auto driver = [[Check::NoThrow]] std::make_shared<DriverClass>(std::forward<Args>(args)...);
+		[[Check::NoThrow]] dir->mount(driver);
+		return MountPointWrapper(root, dir, driver);
 	}
 };
 